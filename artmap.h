@@ -0,0 +1,735 @@
+#ifndef ARTMAP_H
+#define ARTMAP_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+* An adaptive radix tree (Leis et al., ICDE 2013) ordered map for unsigned
+* integer keys, with the insert/remove/find/operator[]/iterator API of
+* BinarySearchTree.
+*
+* Keys are split into bytes, most significant first, and each inner node
+* branches on one byte, so a lookup takes at most sizeof(Key) steps and
+* never compares keys except once at the leaf. Inner nodes grow and
+* shrink between four layouts to stay compact:
+*  - Node4/Node16: sorted key bytes and children (Node16 is searched with
+*    one SSE2 compare when available),
+*  - Node48: a 256-entry byte index into 48 child slots,
+*  - Node256: a direct array of children.
+* Inner nodes store the key bytes shared by everything below them (path
+* compression); with fixed-width keys the whole prefix always fits.
+*
+* Iteration is in ascending key order. Iterators keep the path from the
+* root, so ++ is amortized O(1).
+*/
+template <typename Key, typename Value>
+class ArtMap
+{
+    static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value,
+                  "ArtMap keys must be unsigned integers");
+
+protected:
+    static const int KEY_BYTES = sizeof(Key);
+
+    enum NodeType { NODE4, NODE16, NODE48, NODE256 };
+
+    struct Leaf
+    {
+        Leaf(const Key& key, const Value& value) : item(key, value) {}
+        std::pair<const Key, Value> item;
+    };
+
+    struct Inner
+    {
+        uint8_t type;
+        uint8_t prefixLen;
+        uint16_t count;
+        uint8_t prefix[KEY_BYTES];
+    };
+
+    struct Node4 : Inner
+    {
+        uint8_t keys[4];
+        void* children[4];
+    };
+
+    struct Node16 : Inner
+    {
+        uint8_t keys[16];
+        void* children[16];
+    };
+
+    struct Node48 : Inner
+    {
+        uint8_t index[256];     // slot + 1, or 0 if the byte has no child
+        void* children[48];
+    };
+
+    struct Node256 : Inner
+    {
+        void* children[256];
+    };
+
+public:
+    ArtMap();
+    // Moves take other's nodes in O(1) and leave other empty. The map owns
+    // its nodes, so it is not copyable.
+    ArtMap(ArtMap&& other);
+    ArtMap& operator=(ArtMap&& other);
+    ArtMap(const ArtMap&) = delete;
+    ArtMap& operator=(const ArtMap&) = delete;
+    virtual ~ArtMap();
+    // Exchanges contents with other in O(1)
+    void swap(ArtMap& other);
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+
+    /**
+    * Ordered iterator. Holds the inner nodes on the path to the current
+    * leaf (at most one per key byte) and the position taken in each.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class ArtMap<Key, Value>;
+
+        // Follows the smallest children from p down to a leaf
+        void descend(void* p);
+
+        struct Frame
+        {
+            Inner* node;
+            int pos;
+        };
+        Frame stack_[KEY_BYTES];
+        int depth_;
+        Leaf* leaf_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    // Child pointers are tagged: the low bit marks a Leaf
+    static bool isLeaf(const void* p);
+    static Leaf* asLeaf(void* p);
+    static void* tagLeaf(Leaf* leaf);
+
+    // The depth-th byte of key, most significant first
+    static uint8_t keyByte(Key key, int depth);
+
+    // Positions are slot indices in Node4/16 and key bytes in Node48/256.
+    // Position of the child for byte, or -1
+    static int findPos(const Inner* n, uint8_t byte);
+    // First position >= from holding a child, or -1
+    static int nextPos(const Inner* n, int from);
+    static void*& childAt(Inner* n, int pos);
+
+    static Inner* newInner(NodeType type);
+    static void freeInner(Inner* n);
+
+    // Adds a child for byte to n, first growing n (and updating *ref) if full
+    static void addChild(void** ref, Inner* n, uint8_t byte, void* child);
+    // Removes the child at pos from n, then shrinks or collapses n (updating *ref)
+    static void removeChild(void** ref, Inner* n, int pos);
+
+    Leaf* findLeaf(const Key& key) const;
+
+    void* root_;
+};
+
+template<typename Key, typename Value>
+ArtMap<Key, Value>::ArtMap() : root_(NULL)
+{
+
+}
+
+template<typename Key, typename Value>
+ArtMap<Key, Value>::ArtMap(ArtMap&& other) : root_(other.root_)
+{
+    other.root_ = NULL;
+}
+
+/**
+* Frees this map's nodes, then takes other's. other ends up empty.
+*/
+template<typename Key, typename Value>
+ArtMap<Key, Value>& ArtMap<Key, Value>::operator=(ArtMap&& other)
+{
+    if (this != &other) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+template<typename Key, typename Value>
+ArtMap<Key, Value>::~ArtMap()
+{
+    clear();
+}
+
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::swap(ArtMap& other)
+{
+    std::swap(root_, other.root_);
+}
+
+template<typename Key, typename Value>
+bool ArtMap<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+/**
+* Frees every node with an explicit stack instead of recursion.
+*/
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::clear()
+{
+    std::vector<void*> pending;
+    if (root_ != NULL) pending.push_back(root_);
+    while (!pending.empty()) {
+        void* p = pending.back();
+        pending.pop_back();
+        if (isLeaf(p)) {
+            delete asLeaf(p);
+            continue;
+        }
+        Inner* n = static_cast<Inner*>(p);
+        for (int pos = nextPos(n, 0); pos >= 0; pos = nextPos(n, pos + 1)) {
+            pending.push_back(childAt(n, pos));
+        }
+        freeInner(n);
+    }
+    root_ = NULL;
+}
+
+template<typename Key, typename Value>
+bool ArtMap<Key, Value>::isLeaf(const void* p)
+{
+    return (reinterpret_cast<uintptr_t>(p) & 1) != 0;
+}
+
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::Leaf* ArtMap<Key, Value>::asLeaf(void* p)
+{
+    return reinterpret_cast<Leaf*>(reinterpret_cast<uintptr_t>(p) & ~(uintptr_t)1);
+}
+
+template<typename Key, typename Value>
+void* ArtMap<Key, Value>::tagLeaf(Leaf* leaf)
+{
+    return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(leaf) | 1);
+}
+
+template<typename Key, typename Value>
+uint8_t ArtMap<Key, Value>::keyByte(Key key, int depth)
+{
+    return (uint8_t)(key >> (8 * (KEY_BYTES - 1 - depth)));
+}
+
+template<typename Key, typename Value>
+int ArtMap<Key, Value>::findPos(const Inner* n, uint8_t byte)
+{
+    switch (n->type) {
+    case NODE4: {
+        const Node4* n4 = static_cast<const Node4*>(n);
+        for (int i = 0; i < n->count; ++i) {
+            if (n4->keys[i] == byte) return i;
+        }
+        return -1;
+    }
+    case NODE16: {
+        const Node16* n16 = static_cast<const Node16*>(n);
+#if defined(__SSE2__)
+        // Compare all 16 key bytes at once and mask off unused slots
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys)));
+        int mask = _mm_movemask_epi8(cmp) & ((1 << n->count) - 1);
+        return mask ? __builtin_ctz(mask) : -1;
+#else
+        for (int i = 0; i < n->count; ++i) {
+            if (n16->keys[i] == byte) return i;
+        }
+        return -1;
+#endif
+    }
+    case NODE48:
+        return static_cast<const Node48*>(n)->index[byte] ? byte : -1;
+    default:
+        return static_cast<const Node256*>(n)->children[byte] ? byte : -1;
+    }
+}
+
+template<typename Key, typename Value>
+int ArtMap<Key, Value>::nextPos(const Inner* n, int from)
+{
+    switch (n->type) {
+    case NODE4:
+    case NODE16:
+        return (from < n->count) ? from : -1;
+    case NODE48: {
+        const Node48* n48 = static_cast<const Node48*>(n);
+        for (int b = from; b < 256; ++b) {
+            if (n48->index[b]) return b;
+        }
+        return -1;
+    }
+    default: {
+        const Node256* n256 = static_cast<const Node256*>(n);
+        for (int b = from; b < 256; ++b) {
+            if (n256->children[b]) return b;
+        }
+        return -1;
+    }
+    }
+}
+
+template<typename Key, typename Value>
+void*& ArtMap<Key, Value>::childAt(Inner* n, int pos)
+{
+    switch (n->type) {
+    case NODE4:
+        return static_cast<Node4*>(n)->children[pos];
+    case NODE16:
+        return static_cast<Node16*>(n)->children[pos];
+    case NODE48: {
+        Node48* n48 = static_cast<Node48*>(n);
+        return n48->children[n48->index[pos] - 1];
+    }
+    default:
+        return static_cast<Node256*>(n)->children[pos];
+    }
+}
+
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::Inner* ArtMap<Key, Value>::newInner(NodeType type)
+{
+    Inner* n;
+    switch (type) {
+    case NODE4: n = new Node4(); break;
+    case NODE16: n = new Node16(); break;
+    case NODE48: n = new Node48(); break;
+    default: n = new Node256(); break;
+    }
+    n->type = type;
+    n->prefixLen = 0;
+    n->count = 0;
+    return n;
+}
+
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::freeInner(Inner* n)
+{
+    switch (n->type) {
+    case NODE4: delete static_cast<Node4*>(n); break;
+    case NODE16: delete static_cast<Node16*>(n); break;
+    case NODE48: delete static_cast<Node48*>(n); break;
+    default: delete static_cast<Node256*>(n); break;
+    }
+}
+
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::addChild(void** ref, Inner* n, uint8_t byte, void* child)
+{
+    // Grow into the next larger layout, keeping the header
+    if ((n->type == NODE4 && n->count == 4) || (n->type == NODE16 && n->count == 16) ||
+        (n->type == NODE48 && n->count == 48)) {
+        Inner* bigger = newInner((NodeType)(n->type + 1));
+        bigger->prefixLen = n->prefixLen;
+        std::memcpy(bigger->prefix, n->prefix, KEY_BYTES);
+        for (int pos = nextPos(n, 0); pos >= 0; pos = nextPos(n, pos + 1)) {
+            uint8_t b = (n->type == NODE4) ? static_cast<Node4*>(n)->keys[pos] :
+                        (n->type == NODE16) ? static_cast<Node16*>(n)->keys[pos] : (uint8_t)pos;
+            addChild(ref, bigger, b, childAt(n, pos));
+        }
+        freeInner(n);
+        *ref = bigger;
+        n = bigger;
+    }
+
+    switch (n->type) {
+    case NODE4:
+    case NODE16: {
+        uint8_t* keys = (n->type == NODE4) ? static_cast<Node4*>(n)->keys : static_cast<Node16*>(n)->keys;
+        void** children = (n->type == NODE4) ? static_cast<Node4*>(n)->children : static_cast<Node16*>(n)->children;
+        int i = n->count;
+        while (i > 0 && keys[i - 1] > byte) {
+            keys[i] = keys[i - 1];
+            children[i] = children[i - 1];
+            --i;
+        }
+        keys[i] = byte;
+        children[i] = child;
+        break;
+    }
+    case NODE48: {
+        Node48* n48 = static_cast<Node48*>(n);
+        int slot = 0;
+        while (n48->children[slot] != NULL) ++slot;
+        n48->children[slot] = child;
+        n48->index[byte] = (uint8_t)(slot + 1);
+        break;
+    }
+    default:
+        static_cast<Node256*>(n)->children[byte] = child;
+        break;
+    }
+    ++n->count;
+}
+
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::removeChild(void** ref, Inner* n, int pos)
+{
+    switch (n->type) {
+    case NODE4:
+    case NODE16: {
+        uint8_t* keys = (n->type == NODE4) ? static_cast<Node4*>(n)->keys : static_cast<Node16*>(n)->keys;
+        void** children = (n->type == NODE4) ? static_cast<Node4*>(n)->children : static_cast<Node16*>(n)->children;
+        for (int i = pos; i + 1 < n->count; ++i) {
+            keys[i] = keys[i + 1];
+            children[i] = children[i + 1];
+        }
+        break;
+    }
+    case NODE48: {
+        Node48* n48 = static_cast<Node48*>(n);
+        n48->children[n48->index[pos] - 1] = NULL;
+        n48->index[pos] = 0;
+        break;
+    }
+    default:
+        static_cast<Node256*>(n)->children[pos] = NULL;
+        break;
+    }
+    --n->count;
+
+    // A Node4 with one child is replaced by that child, which absorbs
+    // the node's prefix and branch byte
+    if (n->type == NODE4 && n->count == 1) {
+        Node4* n4 = static_cast<Node4*>(n);
+        void* only = n4->children[0];
+        if (!isLeaf(only)) {
+            Inner* c = static_cast<Inner*>(only);
+            uint8_t merged[KEY_BYTES];
+            int len = n->prefixLen;
+            std::memcpy(merged, n->prefix, len);
+            merged[len++] = n4->keys[0];
+            std::memcpy(merged + len, c->prefix, c->prefixLen);
+            len += c->prefixLen;
+            std::memcpy(c->prefix, merged, len);
+            c->prefixLen = (uint8_t)len;
+        }
+        *ref = only;
+        freeInner(n);
+        return;
+    }
+
+    // Shrink with some hysteresis below the grow thresholds
+    if ((n->type == NODE16 && n->count < 4) || (n->type == NODE48 && n->count < 13) ||
+        (n->type == NODE256 && n->count < 37)) {
+        Inner* smaller = newInner((NodeType)(n->type - 1));
+        smaller->prefixLen = n->prefixLen;
+        std::memcpy(smaller->prefix, n->prefix, KEY_BYTES);
+        for (int p = nextPos(n, 0); p >= 0; p = nextPos(n, p + 1)) {
+            uint8_t b = (n->type == NODE16) ? static_cast<Node16*>(n)->keys[p] : (uint8_t)p;
+            addChild(ref, smaller, b, childAt(n, p));
+        }
+        freeInner(n);
+        *ref = smaller;
+    }
+}
+
+/**
+* Recall: If key is already in the tree, you should
+* overwrite the current value with the updated value.
+*/
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    const Key& key = keyValuePair.first;
+    void** ref = &root_;
+    int depth = 0;
+
+    while (true) {
+        void* p = *ref;
+        if (p == NULL) {
+            *ref = tagLeaf(new Leaf(key, keyValuePair.second));
+            return;
+        }
+
+        if (isLeaf(p)) {
+            Leaf* leaf = asLeaf(p);
+            if (leaf->item.first == key) {
+                leaf->item.second = keyValuePair.second;
+                return;
+            }
+
+            // Two leaves: a Node4 holds the bytes they share from here on
+            Inner* n = newInner(NODE4);
+            int len = 0;
+            while (keyByte(leaf->item.first, depth + len) == keyByte(key, depth + len)) {
+                n->prefix[len] = keyByte(key, depth + len);
+                ++len;
+            }
+            n->prefixLen = (uint8_t)len;
+            addChild(ref, n, keyByte(leaf->item.first, depth + len), p);
+            addChild(ref, n, keyByte(key, depth + len), tagLeaf(new Leaf(key, keyValuePair.second)));
+            *ref = n;
+            return;
+        }
+
+        Inner* n = static_cast<Inner*>(p);
+        int matched = 0;
+        while (matched < n->prefixLen && n->prefix[matched] == keyByte(key, depth + matched)) ++matched;
+
+        // Key leaves the compressed path: split it with a new Node4
+        if (matched < n->prefixLen) {
+            Inner* split = newInner(NODE4);
+            split->prefixLen = (uint8_t)matched;
+            std::memcpy(split->prefix, n->prefix, matched);
+            uint8_t oldByte = n->prefix[matched];
+            n->prefixLen = (uint8_t)(n->prefixLen - matched - 1);
+            std::memmove(n->prefix, n->prefix + matched + 1, n->prefixLen);
+            addChild(ref, split, oldByte, n);
+            addChild(ref, split, keyByte(key, depth + matched), tagLeaf(new Leaf(key, keyValuePair.second)));
+            *ref = split;
+            return;
+        }
+
+        depth += n->prefixLen;
+        uint8_t byte = keyByte(key, depth);
+        int pos = findPos(n, byte);
+        if (pos < 0) {
+            addChild(ref, n, byte, tagLeaf(new Leaf(key, keyValuePair.second)));
+            return;
+        }
+        ref = &childAt(n, pos);
+        ++depth;
+    }
+}
+
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::remove(const Key& key)
+{
+    void** ref = &root_;
+    void** parentRef = NULL;
+    Inner* parent = NULL;
+    int parentPos = 0;
+    int depth = 0;
+
+    while (true) {
+        void* p = *ref;
+        if (p == NULL) return;
+
+        if (isLeaf(p)) {
+            Leaf* leaf = asLeaf(p);
+            if (leaf->item.first != key) return;
+            delete leaf;
+            if (parent == NULL) {
+                root_ = NULL;
+            } else {
+                removeChild(parentRef, parent, parentPos);
+            }
+            return;
+        }
+
+        Inner* n = static_cast<Inner*>(p);
+        for (int i = 0; i < n->prefixLen; ++i) {
+            if (n->prefix[i] != keyByte(key, depth + i)) return;
+        }
+        depth += n->prefixLen;
+        int pos = findPos(n, keyByte(key, depth));
+        if (pos < 0) return;
+
+        parentRef = ref;
+        parent = n;
+        parentPos = pos;
+        ref = &childAt(n, pos);
+        ++depth;
+    }
+}
+
+/**
+* Inner node prefixes are not checked on the way down; the single key
+* comparison at the leaf catches any mismatch.
+*/
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::Leaf* ArtMap<Key, Value>::findLeaf(const Key& key) const
+{
+    void* p = root_;
+    int depth = 0;
+    while (p != NULL && !isLeaf(p)) {
+        Inner* n = static_cast<Inner*>(p);
+        depth += n->prefixLen;
+        int pos = findPos(n, keyByte(key, depth));
+        if (pos < 0) return NULL;
+        p = childAt(n, pos);
+        ++depth;
+    }
+    if (p == NULL) return NULL;
+    Leaf* leaf = asLeaf(p);
+    return (leaf->item.first == key) ? leaf : NULL;
+}
+
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::iterator ArtMap<Key, Value>::begin() const
+{
+    iterator it;
+    it.descend(root_);
+    return it;
+}
+
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::iterator ArtMap<Key, Value>::end() const
+{
+    return iterator();
+}
+
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::iterator ArtMap<Key, Value>::find(const Key& key) const
+{
+    // Same descent as findLeaf, recording the path for the iterator
+    iterator it;
+    void* p = root_;
+    int depth = 0;
+    while (p != NULL && !isLeaf(p)) {
+        Inner* n = static_cast<Inner*>(p);
+        depth += n->prefixLen;
+        int pos = findPos(n, keyByte(key, depth));
+        if (pos < 0) return end();
+        it.stack_[it.depth_].node = n;
+        it.stack_[it.depth_].pos = pos;
+        ++it.depth_;
+        p = childAt(n, pos);
+        ++depth;
+    }
+    if (p == NULL || asLeaf(p)->item.first != key) return end();
+    it.leaf_ = asLeaf(p);
+    return it;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<typename Key, typename Value>
+Value& ArtMap<Key, Value>::operator[](const Key& key)
+{
+    Leaf* leaf = findLeaf(key);
+    if (leaf == NULL) throw std::out_of_range("Invalid key");
+    return leaf->item.second;
+}
+
+template<typename Key, typename Value>
+Value const & ArtMap<Key, Value>::operator[](const Key& key) const
+{
+    Leaf* leaf = findLeaf(key);
+    if (leaf == NULL) throw std::out_of_range("Invalid key");
+    return leaf->item.second;
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the ArtMap::iterator class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+ArtMap<Key, Value>::iterator::iterator() : depth_(0), leaf_(NULL)
+{
+
+}
+
+template<typename Key, typename Value>
+std::pair<const Key,Value>& ArtMap<Key, Value>::iterator::operator*() const
+{
+    return leaf_->item;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key,Value>* ArtMap<Key, Value>::iterator::operator->() const
+{
+    return &(leaf_->item);
+}
+
+template<typename Key, typename Value>
+bool ArtMap<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return leaf_ == rhs.leaf_;
+}
+
+template<typename Key, typename Value>
+bool ArtMap<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return leaf_ != rhs.leaf_;
+}
+
+template<typename Key, typename Value>
+void ArtMap<Key, Value>::iterator::descend(void* p)
+{
+    // Inner nodes always have at least two children
+    while (p != NULL && !isLeaf(p)) {
+        Inner* n = static_cast<Inner*>(p);
+        int pos = nextPos(n, 0);
+        stack_[depth_].node = n;
+        stack_[depth_].pos = pos;
+        ++depth_;
+        p = childAt(n, pos);
+    }
+    leaf_ = (p == NULL) ? NULL : asLeaf(p);
+}
+
+template<typename Key, typename Value>
+typename ArtMap<Key, Value>::iterator& ArtMap<Key, Value>::iterator::operator++()
+{
+    // Back up to the deepest node with a later child, then take its leftmost leaf
+    while (depth_ > 0) {
+        Frame& top = stack_[depth_ - 1];
+        int next = nextPos(top.node, top.pos + 1);
+        if (next >= 0) {
+            top.pos = next;
+            descend(childAt(top.node, next));
+            return *this;
+        }
+        --depth_;
+    }
+    leaf_ = NULL;
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ArtMap::iterator class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -6,6 +6,8 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <new>
+#include <vector>
 #include "bst.h"
 
 struct KeyError { };
@@ -28,6 +30,17 @@ public:
     void setBalance (int8_t balance);
     void updateBalance(int8_t diff);
 
+    // Getter/setter for the node's rank (only used in rank-balanced mode).
+    int8_t getRank () const;
+    void setRank (int8_t rank);
+
+    // Tombstone state (only used with AVLTree::setTombstones). A queued
+    // node is on the tree's purge list, whether or not it is still dead.
+    virtual bool isDead() const override;
+    void setDead(bool dead);
+    bool isQueued() const;
+    void setQueued(bool queued);
+
     // Getters for parent, left, and right. These need to be redefined since they
     // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
     // for more information.
@@ -37,6 +50,9 @@ public:
 
 protected:
     int8_t balance_;    // effectively a signed char
+    int8_t rank_;       // fits in the padding after balance_
+    bool dead_;         // as does the tombstone state
+    bool queued_;
 };
 
 /*
@@ -50,7 +66,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), rank_(0), dead_(false), queued_(false)
 {
 
 }
@@ -91,6 +107,48 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
     balance_ += diff;
 }
 
+/**
+* A getter for the rank of a AVLNode.
+*/
+template<class Key, class Value>
+int8_t AVLNode<Key, Value>::getRank() const
+{
+    return rank_;
+}
+
+/**
+* A setter for the rank of a AVLNode.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setRank(int8_t rank)
+{
+    rank_ = rank;
+}
+
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isDead() const
+{
+    return dead_;
+}
+
+template<class Key, class Value>
+void AVLNode<Key, Value>::setDead(bool dead)
+{
+    dead_ = dead;
+}
+
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isQueued() const
+{
+    return queued_;
+}
+
+template<class Key, class Value>
+void AVLNode<Key, Value>::setQueued(bool queued)
+{
+    queued_ = queued;
+}
+
 /**
 * An overridden function for getting the parent since a static_cast is necessary to make sure
 * that our node is a AVLNode.
@@ -127,18 +185,102 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 */
 
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+/**
+* An AVL tree. Optionally runs in rank-balanced (weak AVL, WAVL) mode:
+* nodes keep a rank instead of a balance, every child's rank difference is
+* 1 or 2, and leaves have rank 0. Without deletes this is exactly an AVL
+* tree; with deletes the height stays under 2 log n while rebalancing is
+* O(1) amortized per update and at most 2 rotations per remove, instead of
+* the removeFix cascade. In that mode balance_ is not maintained.
+*
+* Inserts can start from a finger instead of the root: insert(hint, item)
+* starts at the hinted item (end() means the largest), and in finger-search
+* mode plain insert starts at the previous insertion point. The search
+* climbs only until it reaches a subtree whose key range holds the new key,
+* so appending ever-larger keys finds its spot in O(1), and keys landing
+* d items from the finger usually take O(log d) instead of O(log n).
+*
+* With setTombstones(f), remove only marks the node dead: one O(log n)
+* search, no swaps and no rebalancing. find, lower_bound, operator[] and
+* iterators skip dead nodes, and inserting a dead key revives its node.
+* Once more than a fraction f of the nodes are dead, the next remove
+* rebuilds the tree without them in O(n), so each remove costs O(1/f)
+* amortized. purgeTombstones(budget) instead erases a bounded number of
+* tombstones for real, to spread that work over idle time.
+*
+* Nodes allocated one by one end up scattered over the heap after enough
+* churn. compact() copies them all into one contiguous block, laid out
+* for searches (breadth-first or van Emde Boas order) or for scans (key
+* order), and frees the originals. Nodes inserted later are allocated as
+* usual; nodes removed from the block leave holes in it, and the block is
+* freed once its last node is.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class AVLTree : public BinarySearchTree<Key, Value, Compare>
 {
 public:
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+
+    AVLTree();
+    explicit AVLTree(bool rankBalanced, const Compare& comp = Compare());
+    AVLTree(AVLTree&& other);
+    AVLTree& operator=(AVLTree&& other);
+    // Frees the nodes here, where releaseNode still reaches this class
+    virtual ~AVLTree();
+    // O(1), including the finger and tombstone state
+    void swap(AVLTree& other);
+    // Copies shape, balances, ranks and tombstones node by node in O(n).
+    // The copy has no finger yet and queues its tombstones in key order.
+    AVLTree clone() const;
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
-    virtual void remove(const Key& key);  // TODO
+    // Inserts starting the search from hint; returns the item's position
+    iterator insert(iterator hint, const std::pair<const Key, Value>& new_item);
+    virtual bool isBalanced() const;
+    virtual int height() const;
+    bool isRankBalanced() const;
+
+    // Finger-search mode: plain insert starts from the last insertion point
+    void setFingerSearch(bool on);
+    bool fingerSearch() const;
+
+    // Instrumentation: key comparisons made by inserts to find their spot
+    // (the finger climb and the descent), since construction or the last
+    // resetSearchComparisons()
+    size_t searchComparisons() const;
+    void resetSearchComparisons();
+
+    virtual void clear();
+
+    // Tombstone mode: lazy removes, rebuilding once more than
+    // maxDeadFraction of the nodes are dead. 0 turns it off, dropping any
+    // tombstones left.
+    void setTombstones(double maxDeadFraction);
+    size_t tombstoneCount() const;
+    // Drops every tombstone and relinks the rest perfectly balanced, in O(n)
+    void rebuild();
+    // Erases up to budget tombstones; returns how many are left
+    size_t purgeTombstones(size_t budget);
+
+    // Splits [lo, hi) out of the tree, frees it in bulk and joins the rest
+    // back in O(log n + k). Rank-balanced trees erase the items one at a
+    // time; in tombstone mode the range is buried, with one rebuild check.
+    virtual size_t eraseRange(const Key& lo, const Key& hi);
+
+    // Node layouts for compact()
+    enum NodeOrder { BREADTH_FIRST, VAN_EMDE_BOAS, IN_ORDER };
+    // Moves every node into one contiguous block in the given order and
+    // frees the old ones, in O(n) (O(n log log n) for VAN_EMDE_BOAS).
+    // Invalidates iterators, since the items move.
+    void compact(NodeOrder order = VAN_EMDE_BOAS);
+
 protected:
+    virtual std::function<void()> detachNodes();
+
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
 
     // Add helper functions here
-    void leftRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* rChild);
-    void rightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* lChild);
+    using BinarySearchTree<Key, Value, Compare>::leftRotate;
+    using BinarySearchTree<Key, Value, Compare>::rightRotate;
     int getHeight(AVLNode<Key, Value>* current, int height=0);
 
     // When child and current are both right children (since it requires a left rotate)
@@ -156,49 +298,345 @@ protected:
     void zigZagRightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child);
 
     // Helper functions for insert
-    void AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<Key, Value>* newNode);
+    // (AVLinsertHelper returns the node that holds newNode's key afterwards)
+    AVLNode<Key, Value>* AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<Key, Value>* newNode);
     void insertFix(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child);
 
     // Helper functions for remove
-    void AVLremoveHelper(AVLNode<Key, Value>* current, const Key& key);
+    // (eraseNode buries the node in tombstone mode; unlinkNode always
+    // takes it out of the tree and frees it)
+    virtual void eraseNode(Node<Key, Value>* node);
+    void unlinkNode(AVLNode<Key, Value>* current);
+    // Marks a live node dead and queues it for purging
+    void bury(AVLNode<Key, Value>* current);
     void removeFix(AVLNode<Key, Value>* current, int diff);
 
+    // Rank-balanced (WAVL) mode
+    static int rank(AVLNode<Key, Value>* n);
+    AVLNode<Key, Value>* WAVLinsert(AVLNode<Key, Value>* current, const std::pair<const Key, Value>& new_item);
+    void WAVLinsertFix(AVLNode<Key, Value>* child);
+    void WAVLerase(AVLNode<Key, Value>* current);
+    void WAVLremoveFix(AVLNode<Key, Value>* child, AVLNode<Key, Value>* parent);
+
+    // Finger search
+    // Inserts below start (the root if NULL), which must be an ancestor of
+    // the new key's position; returns the node holding the key
+    AVLNode<Key, Value>* insertFrom(AVLNode<Key, Value>* start, const std::pair<const Key, Value>& new_item);
+    // Lowest node on from's path to the root whose subtree covers key
+    template<typename K>
+    AVLNode<Key, Value>* fingerStart(const K& key, AVLNode<Key, Value>* from) const;
+
+    // Sets balance and rank for nodes placed by linkBalanced
+    virtual void relinked(Node<Key, Value>* n, int leftHeight, int rightHeight);
+
+    // Cloning: copyNode makes AVLNodes; copyAVLNode copies one's balancing
+    // and tombstone fields for subclasses with their own node type
+    virtual Node<Key, Value>* copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const;
+    static void copyAVLNode(const AVLNode<Key, Value>* from, AVLNode<Key, Value>* to);
+    // Base copyInto plus this tree's settings, node count and purge list
+    void copyInto(AVLTree& copy) const;
+
+    // Split and join for eraseRange (plain AVL mode). Subtrees are passed
+    // detached, with their heights (NULL has height 0), and results come
+    // back detached too. join links left < mid < right into one AVL
+    // subtree, walking down the taller side only as far as the height
+    // difference. splitAt cuts t into keys < key and keys >= key; splitMin
+    // takes the smallest node out of t. Each is O(log n) overall.
+    static int spineHeight(AVLNode<Key, Value>* n);
+    AVLNode<Key, Value>* join(AVLNode<Key, Value>* left, int leftHeight, AVLNode<Key, Value>* mid,
+                              AVLNode<Key, Value>* right, int rightHeight, int& height);
+    void splitAt(AVLNode<Key, Value>* t, int height, const Key& key,
+                 AVLNode<Key, Value>*& left, int& leftHeight, AVLNode<Key, Value>*& right, int& rightHeight);
+    AVLNode<Key, Value>* splitMin(AVLNode<Key, Value>* t, int height, AVLNode<Key, Value>*& rest, int& restHeight);
+    // Called bottom-up for every node whose subtree join changed, after
+    // balances are final, so subclasses can refresh per-node aggregates
+    virtual void joined(AVLNode<Key, Value>* n);
+
+    // Compaction: the size of this tree's node type, and a copy of n
+    // (links included) constructed at slot. Subclasses with their own node
+    // type override both.
+    virtual size_t nodeBytes() const;
+    virtual AVLNode<Key, Value>* relocateNode(AVLNode<Key, Value>* n, void* slot) const;
+    // Appends the nodes in the top levels levels of t to out, in van Emde
+    // Boas order: the top half of the levels, then each subtree below it
+    static void vebOrder(AVLNode<Key, Value>* t, int levels, std::vector<AVLNode<Key, Value>*>& out);
+    // Nodes inside block_ are only destroyed; the block itself is freed
+    // with its last node
+    virtual void releaseNode(Node<Key, Value>* n);
+    static bool inBlock(const char* block, size_t bytes, const Node<Key, Value>* n);
+
+    bool rankBalanced_;
+    bool fingerSearch_;
+    AVLNode<Key, Value>* finger_;   // last insertion point; NULL once removed
+    bool fingerIsMax_;              // finger_ holds the largest key
+    mutable size_t searchComparisons_;
+    size_t nodes_;                  // linked nodes, tombstones included
+    double maxDeadFraction_;        // 0 unless in tombstone mode
+    std::vector<AVLNode<Key, Value>*> graves_;  // queued nodes, oldest first
+    char* block_;                   // nodes placed by compact(), NULL if none
+    size_t blockBytes_;
+    size_t blockLive_;              // nodes still in block_
 
 };
 
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree() :
+    rankBalanced_(false), fingerSearch_(false), finger_(NULL), fingerIsMax_(false), searchComparisons_(0),
+    nodes_(0), maxDeadFraction_(0), block_(NULL), blockBytes_(0), blockLive_(0)
+{
+
+}
+
+/**
+* Creates an empty tree ordered by comp; rankBalanced selects WAVL mode.
+*/
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(bool rankBalanced, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp), rankBalanced_(rankBalanced),
+    fingerSearch_(false), finger_(NULL), fingerIsMax_(false), searchComparisons_(0),
+    nodes_(0), maxDeadFraction_(0), block_(NULL), blockBytes_(0), blockLive_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(AVLTree&& other) :
+    BinarySearchTree<Key, Value, Compare>(std::move(other)), rankBalanced_(other.rankBalanced_),
+    fingerSearch_(other.fingerSearch_), finger_(other.finger_), fingerIsMax_(other.fingerIsMax_),
+    searchComparisons_(other.searchComparisons_), nodes_(other.nodes_), maxDeadFraction_(other.maxDeadFraction_), graves_(std::move(other.graves_)),
+    block_(other.block_), blockBytes_(other.blockBytes_), blockLive_(other.blockLive_)
+{
+    other.finger_ = NULL;
+    other.fingerIsMax_ = false;
+    other.nodes_ = 0;
+    other.graves_.clear();
+    other.block_ = NULL;
+    other.blockBytes_ = 0;
+    other.blockLive_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>& AVLTree<Key, Value, Compare>::operator=(AVLTree&& other)
+{
+    if (this != &other) {
+        this->clear();
+        swap(other);
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::~AVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::swap(AVLTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+    std::swap(rankBalanced_, other.rankBalanced_);
+    std::swap(fingerSearch_, other.fingerSearch_);
+    std::swap(finger_, other.finger_);
+    std::swap(fingerIsMax_, other.fingerIsMax_);
+    std::swap(searchComparisons_, other.searchComparisons_);
+    std::swap(nodes_, other.nodes_);
+    std::swap(maxDeadFraction_, other.maxDeadFraction_);
+    graves_.swap(other.graves_);
+    std::swap(block_, other.block_);
+    std::swap(blockBytes_, other.blockBytes_);
+    std::swap(blockLive_, other.blockLive_);
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare> AVLTree<Key, Value, Compare>::clone() const
+{
+    AVLTree<Key, Value, Compare> copy(rankBalanced_, this->comp_);
+    copyInto(copy);
+    return copy;
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* AVLTree<Key, Value, Compare>::copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const
+{
+    const AVLNode<Key, Value>* from = static_cast<const AVLNode<Key, Value>*>(n);
+    AVLNode<Key, Value>* to = new AVLNode<Key, Value>(from->getKey(), from->getValue(),
+                                                      static_cast<AVLNode<Key, Value>*>(parent));
+    copyAVLNode(from, to);
+    return to;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::copyAVLNode(const AVLNode<Key, Value>* from, AVLNode<Key, Value>* to)
+{
+    to->setBalance(from->getBalance());
+    to->setRank(from->getRank());
+    to->setDead(from->isDead());
+    to->setQueued(from->isQueued());
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::copyInto(AVLTree& copy) const
+{
+    BinarySearchTree<Key, Value, Compare>::copyInto(copy);
+    copy.fingerSearch_ = fingerSearch_;
+    copy.nodes_ = nodes_;
+    copy.maxDeadFraction_ = maxDeadFraction_;
+    if (graves_.empty()) return;
+
+    copy.graves_.reserve(graves_.size());
+    for (Node<Key, Value>* n = copy.getSmallestNode(); n != NULL; n = copy.successor(n)) {
+        AVLNode<Key, Value>* a = static_cast<AVLNode<Key, Value>*>(n);
+        if (a->isQueued()) copy.graves_.push_back(a);
+    }
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::isRankBalanced() const
+{
+    return rankBalanced_;
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
 {
-    // First create a new node
-    AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
+    if (!fingerSearch_ || finger_ == NULL) {
+        finger_ = insertFrom(NULL, new_item);
+        fingerIsMax_ = false;
+        return;
+    }
+
+    // Appending past the largest key: the finger has no right child, so
+    // the new node goes directly below it
+    if (fingerIsMax_) {
+        ++searchComparisons_;
+        if (this->compareKeys(new_item.first, finger_->getKey()) > 0) {
+            finger_ = insertFrom(finger_, new_item);
+            return;
+        }
+    }
 
-    // If empty tree, set newNode as root_ and return
+    finger_ = insertFrom(fingerStart(new_item.first, finger_), new_item);
+    fingerIsMax_ = (this->successor(finger_) == NULL);
+}
+
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::iterator
+AVLTree<Key, Value, Compare>::insert(iterator hint, const std::pair<const Key, Value>& new_item)
+{
+    AVLNode<Key, Value>* from = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(hint));
+    if (from == NULL) from = static_cast<AVLNode<Key, Value>*>(this->findMax(this->root_));
+
+    finger_ = insertFrom(from == NULL ? NULL : fingerStart(new_item.first, from), new_item);
+    fingerIsMax_ = false;
+    return this->makeIterator(finger_);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::setFingerSearch(bool on)
+{
+    fingerSearch_ = on;
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::fingerSearch() const
+{
+    return fingerSearch_;
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::searchComparisons() const
+{
+    return searchComparisons_;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::resetSearchComparisons()
+{
+    searchComparisons_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::insertFrom(AVLNode<Key, Value>* start, const std::pair<const Key, Value>& new_item)
+{
+    // If empty tree, the new node becomes root_
     if (this->root_ == NULL) {
-        this->root_ = newNode;
-        return;
+        this->root_ = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
+        nodes_ = 1;
+        this->noteInserted(this->root_);
+        return static_cast<AVLNode<Key, Value>*>(this->root_);
     }
+    if (start == NULL) start = static_cast<AVLNode<Key, Value>*>(this->root_);
 
-    // Else call insert helper which is recursive (to avoid making new nodes on each call of newNode)
-    AVLinsertHelper(static_cast<AVLNode<Key, Value>*>(this->root_), newNode);
+    AVLNode<Key, Value>* node;
+    if (rankBalanced_) {
+        node = WAVLinsert(start, new_item);
+    } else {
+        // Else call insert helper which is recursive (to avoid making new nodes on each call of newNode)
+        AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
+        node = AVLinsertHelper(start, newNode);
+    }
 
+    // Inserting a buried key brings its node back
+    if (this->tombstones_ != 0 && node->isDead()) {
+        node->setDead(false);
+        --this->tombstones_;
+    }
+    this->noteInserted(node);
+    return node;
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<Key, Value>* newNode)
+/**
+* Climbs from from towards the root. A subtree's key range is bounded by
+* the nearest ancestor it hangs to the left of (above) and to the right of
+* (below); only the bound on key's side of from matters, so the climb skips
+* links on the other side and compares once per bound it reaches.
+*/
+template<class Key, class Value, class Compare>
+template<typename K>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::fingerStart(const K& key, AVLNode<Key, Value>* from) const
 {
+    int c = this->compareKeys(key, from->getKey());
+    ++searchComparisons_;
+    if (c == 0) return from;
+
+    while (true) {
+        // Find the bound: the first ancestor that from is not on key's side of
+        AVLNode<Key, Value>* child = from;
+        AVLNode<Key, Value>* bound = from->getParent();
+        while (bound != NULL && (c > 0 ? bound->getRight() : bound->getLeft()) == child) {
+            child = bound;
+            bound = bound->getParent();
+        }
+        if (bound == NULL) return from;
+
+        int b = this->compareKeys(key, bound->getKey());
+        ++searchComparisons_;
+        if (b == 0) return bound;
+        if ((b > 0) != (c > 0)) return from;
+        from = bound;
+    }
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<Key, Value>* newNode)
+{
+    int c = this->compareKeys(newNode->getKey(), current->getKey());
+    ++searchComparisons_;
+
     /**
      * Base case: key is found in tree
      * 
      * Desired action: Replace current value with new value
     */
-    if (newNode->getKey() == current->getKey()) {
+    if (c == 0) {
         current->setValue(newNode->getValue());
         delete newNode;
-        return;
+        return current;
     }
 
     /**
@@ -208,16 +646,16 @@ void AVLTree<Key, Value>::AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<
      *  If left child exists, recurse.
      *  Else, set newNode as left child of current and update balance
     */
-    if (newNode->getKey() < current->getKey()) {
+    if (c < 0) {
 
         if (current->getLeft() != NULL) {
-            AVLinsertHelper(current->getLeft(), newNode);
-            return;
+            return AVLinsertHelper(current->getLeft(), newNode);
 
         } else {
 
             newNode->setParent(current);
             current->setLeft(newNode);
+            ++nodes_;
 
             if (current->getBalance() == 1) {
                 current->setBalance(0);
@@ -227,7 +665,7 @@ void AVLTree<Key, Value>::AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<
                 insertFix(current, current->getParent(), newNode);
 
             }
-            return;
+            return newNode;
         }
     }
     /**
@@ -237,16 +675,16 @@ void AVLTree<Key, Value>::AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<
      *  If right child exists, recurse.
      *  Else, set newNode as right child of current and update balance
     */
-    else if (newNode->getKey() > current->getKey()) {
+    else {
 
         if (current->getRight() != NULL) {
-            AVLinsertHelper(current->getRight(), newNode);
-            return;
+            return AVLinsertHelper(current->getRight(), newNode);
 
         } else {
 
             newNode->setParent(current);
             current->setRight(newNode);
+            ++nodes_;
 
             if (current->getBalance() == -1) {
                 current->setBalance(0);
@@ -255,12 +693,13 @@ void AVLTree<Key, Value>::AVLinsertHelper(AVLNode<Key, Value>* current, AVLNode<
                 current->setBalance(1);
                 insertFix(current, current->getParent(), newNode);
             }
+            return newNode;
         }
     }
 }
 
-template <class Key, class Value>
-void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
+template <class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insertFix(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
 {
     if (current == NULL || parent == NULL) return;
 
@@ -388,92 +827,87 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* current, AVLNode<Key, V
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::remove(const Key& key)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* node)
 {
-    // TODO
-    AVLremoveHelper(static_cast<AVLNode<Key, Value>*>(this->root_), key);
-    return;
+    AVLNode<Key, Value>* current = static_cast<AVLNode<Key, Value>*>(node);
+    this->noteErasing(current);
+    if (maxDeadFraction_ == 0) {
+        unlinkNode(current);
+        --nodes_;
+        return;
+    }
+
+    bury(current);
+    if (this->tombstones_ > maxDeadFraction_ * nodes_) rebuild();
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::AVLremoveHelper(AVLNode<Key, Value>* current, const Key& key)
+/**
+* The node stays linked (and may stay the finger) until a rebuild or
+* purge takes it out.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::bury(AVLNode<Key, Value>* current)
 {
-    /**
-     * Base case: current node is null
-     * 
-     * Desired action: return
-    */
-    if (current == NULL) return;
+    current->setDead(true);
+    ++this->tombstones_;
+    if (!current->isQueued()) {
+        current->setQueued(true);
+        graves_.push_back(current);
+    }
+}
 
-    /**
-     * Base case: current node is to be removed
-     * 
-     * Desired action:
-     *  If two children, swap with predecessor and remove, updating pointers
-     *  If one child, promote child and remove
-     *  If no children, remove
-     *  
-     *  Call removeFix to rebalance tree
-    */
-    if (current->getKey() == key) {
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::unlinkNode(AVLNode<Key, Value>* current)
+{
+    if (current == finger_) finger_ = NULL;
+    if (rankBalanced_) {
+        WAVLerase(current);
+        return;
+    }
 
-        int diff = 0;
-        
-        // Two children case
-        if (current->getLeft() != NULL && current->getRight() != NULL) {
+    int diff = 0;
+    
+    // Two children case
+    if (current->getLeft() != NULL && current->getRight() != NULL) {
 
-            // Swap current with predecessor
-            nodeSwap(current, static_cast<AVLNode<Key, Value>*>(this->predecessor(current))); 
-              
-        }
+        // Swap current with predecessor
+        nodeSwap(current, static_cast<AVLNode<Key, Value>*>(this->predecessor(current))); 
+          
+    }
 
-        // Set diff
-        AVLNode<Key, Value>* parent = current->getParent();
-        if (parent != NULL) {
+    // Set diff
+    AVLNode<Key, Value>* parent = current->getParent();
+    if (parent != NULL) {
 
-            // If current is a left child
-            if (parent->getLeft() == current) {
-                diff = 1;
+        // If current is a left child
+        if (parent->getLeft() == current) {
+            diff = 1;
 
-            // If current is a right child
-            } else if (parent->getRight() == current) {
-                diff = -1;
-            }
+        // If current is a right child
+        } else if (parent->getRight() == current) {
+            diff = -1;
         }
+    }
 
-        // If current has no children, remove
-        if (current->getLeft() == NULL && current->getRight() == NULL) {
-            this->removeNode(current);
-
-        // If current has exactly one child, promote and remove
-        // Note: current cannot have two children at this point
-        } else if (current->getLeft() != NULL) {
-            this->promoteNode(current, current->getParent(), current->getLeft());
-        } else if (current->getRight() != NULL) {
-            this->promoteNode(current, current->getParent(), current->getRight());
-        }
+    // If current has no children, remove
+    if (current->getLeft() == NULL && current->getRight() == NULL) {
+        this->removeNode(current);
 
-        // Call removeFix (returns immediately if current has no parent)
-        removeFix(parent, diff);
+    // If current has exactly one child, promote and remove
+    // Note: current cannot have two children at this point
+    } else if (current->getLeft() != NULL) {
+        this->promoteNode(current, current->getParent(), current->getLeft());
+    } else if (current->getRight() != NULL) {
+        this->promoteNode(current, current->getParent(), current->getRight());
     }
 
-    /**
-     * Recursive case: Current node is not to be removed
-     * 
-     * Desired action: Recurse in the appropriate direction
-    */
-    else if (key > current->getKey()) {
-        AVLremoveHelper(current->getRight(), key);
-    } 
-    else if (key < current->getKey()) {
-        AVLremoveHelper(current->getLeft(), key);
-    }
-    return;
+    // Call removeFix (returns immediately if current has no parent)
+    removeFix(parent, diff);
 }
 
-template<class Key, class Value>
-void AVLTree<Key,Value>::removeFix(AVLNode<Key, Value>* current, int diff)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::removeFix(AVLNode<Key, Value>* current, int diff)
 {
     // If current is null
     if (current == NULL) return;
@@ -610,87 +1044,50 @@ void AVLTree<Key,Value>::removeFix(AVLNode<Key, Value>* current, int diff)
     return;
 }
 
-template<class Key, class Value>
-int AVLTree<Key, Value>::getHeight(AVLNode<Key, Value>* current, int height)
+/**
+ * Fast path for isBalanced: an AVL tree is balanced iff every node's
+ * balance_ is within [-1, 1], so no heights need to be computed.
+ * (Rank-balanced mode has no balance_ and uses the full check.)
+ * Walks the nodes in order through parent pointers (O(n), O(1) space).
+ */
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::isBalanced() const
 {
-    if (current == NULL) return height;
-    else return std::max(getHeight(current->getLeft(), height+1), getHeight(current->getRight(), height+1));
+    if (rankBalanced_) return BinarySearchTree<Key, Value, Compare>::isBalanced();
+    for (Node<Key, Value>* n = this->getSmallestNode(); n != NULL; n = this->successor(n)) {
+        int8_t balance = static_cast<AVLNode<Key, Value>*>(n)->getBalance();
+        if (balance < -1 || balance > 1) return false;
+    }
+    return true;
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::leftRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* rChild)
+/**
+ * Returns the height of the tree in O(log n) by following the taller
+ * child at each level, as recorded by balance_ (O(n) in rank-balanced mode).
+ */
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::height() const
 {
-    // Handles movement of rChild's left child
-    if (rChild->getLeft() != NULL) {
-        current->setRight(rChild->getLeft());
-        rChild->getLeft()->setParent(current);
-    } else {
-        current->setRight(NULL);
-    }
-
-    // Handles if current is root (i.e. has no parent)
-    if (current->getParent() == NULL) {
-        this->root_ = rChild;
-        rChild->setParent(NULL);
-
-    // If current is a left child   
-    } else if (current->getParent()->getLeft() == current) {
-        current->getParent()->setLeft(rChild);
-        rChild->setParent(current->getParent());
-
-    // If current is a right child
-    } else if (current->getParent()->getRight() == current) {
-        current->getParent()->setRight(rChild);
-        rChild->setParent(current->getParent());
+    if (rankBalanced_) return BinarySearchTree<Key, Value, Compare>::height();
+    int h = 0;
+    AVLNode<Key, Value>* current = static_cast<AVLNode<Key, Value>*>(this->root_);
+    while (current != NULL) {
+        ++h;
+        current = (current->getBalance() > 0) ? current->getRight() : current->getLeft();
     }
-
-    // Set rChild as parent of current, completing rotation
-    current->setParent(rChild);
-    rChild->setLeft(current);
-    return;
-
+    return h;
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* lChild)
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::getHeight(AVLNode<Key, Value>* current, int height)
 {
-    // Handles movement of lChild's right child
-    if (lChild->getRight() != NULL) {
-        current->setLeft(lChild->getRight());
-        lChild->getRight()->setParent(current);
-    } else {
-        current->setLeft(NULL);
-    }
-
-    // Handles if current is root (i.e. has no parent)
-    if (current->getParent() == NULL) {
-        this->root_ = lChild;
-        lChild->setParent(NULL);
-    }
-
-    // If current is a left child   
-    else if (current->getParent()->getLeft() == current) {
-        current->getParent()->setLeft(lChild);
-        lChild->setParent(current->getParent());
-
-    // If current is a right child
-    } else if (current->getParent()->getRight() == current) {
-        current->getParent()->setRight(lChild);
-        lChild->setParent(current->getParent());
-    }
-
-    // Set lChild as parent of current, completing rotation
-    current->setParent(lChild);
-    lChild->setRight(current);
-    return;
-    // Adjust balances
-    // current->setBalance(getHeight(current->getRight(), 0) - getHeight(current->getLeft(), 0));
-    // lChild->setBalance(getHeight(lChild->getRight(), 0) - getHeight(lChild->getLeft(), 0));
+    if (current == NULL) return height;
+    else return std::max(getHeight(current->getLeft(), height+1), getHeight(current->getRight(), height+1));
 }
 
 // When child and current are both right children (since it requires a left rotate)
-template <class Key, class Value>
-void AVLTree<Key, Value>::zigZigLeftRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* child)
+template <class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::zigZigLeftRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* child)
 {
     leftRotate(current, child);
     return;
@@ -698,8 +1095,8 @@ void AVLTree<Key, Value>::zigZigLeftRotate(AVLNode<Key, Value>* current, AVLNode
 
 // When current is a right child and child is a left child 
 // Right rotate about current, left rotate about parent
-template <class Key, class Value>
-void AVLTree<Key, Value>::zigZagLeftRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
+template <class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::zigZagLeftRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
 {
     rightRotate(current, child);
     leftRotate(parent, child);
@@ -707,8 +1104,8 @@ void AVLTree<Key, Value>::zigZagLeftRotate(AVLNode<Key, Value>* current, AVLNode
 }
 
 // When child and current are both left children (since it requires a right rotate)
-template <class Key, class Value>
-void AVLTree<Key, Value>::zigZigRightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* child)
+template <class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::zigZigRightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* child)
 {
     rightRotate(current, child);
     return;
@@ -716,21 +1113,670 @@ void AVLTree<Key, Value>::zigZigRightRotate(AVLNode<Key, Value>* current, AVLNod
 
 // When current is a left child and child is a right child 
 // Left rotate about current, right rotate about parent
-template <class Key, class Value>
-void AVLTree<Key, Value>::zigZagRightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
+template <class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::zigZagRightRotate(AVLNode<Key, Value>* current, AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
 {
     leftRotate(current, child);
     rightRotate(parent, child);
     return;
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
+    int8_t tempR = n1->getRank();
+    n1->setRank(n2->getRank());
+    n2->setRank(tempR);
+}
+
+/*
+  -----------------------------------------------
+  Tombstone mode
+  -----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::clear()
+{
+    BinarySearchTree<Key, Value, Compare>::clear();
+    finger_ = NULL;
+    nodes_ = 0;
+    graves_.clear();
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::setTombstones(double maxDeadFraction)
+{
+    maxDeadFraction_ = maxDeadFraction;
+    if (maxDeadFraction_ == 0 && !graves_.empty()) rebuild();
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::tombstoneCount() const
+{
+    return this->tombstones_;
+}
+
+/**
+* Collects the nodes in order, frees the dead ones and relinks the rest
+* with linkBalanced. Needs O(n) extra space for the node list.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rebuild()
+{
+    // Collect everything before freeing anything, since successor() may
+    // climb through nodes that come earlier in the order
+    std::vector<Node<Key, Value>*> live;
+    live.reserve(nodes_);
+    for (Node<Key, Value>* current = this->getSmallestNode(); current != NULL; current = this->successor(current)) {
+        live.push_back(current);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < live.size(); ++i) {
+        AVLNode<Key, Value>* n = static_cast<AVLNode<Key, Value>*>(live[i]);
+        n->setQueued(false);
+        if (n->isDead()) {
+            if (n == finger_) finger_ = NULL;
+            this->destroyNode(n);
+        } else {
+            live[kept++] = n;
+        }
+    }
+    live.resize(kept);
+
+    int height;
+    this->root_ = this->linkBalanced(live, 0, live.size(), NULL, height);
+    this->resetEnds();
+    nodes_ = live.size();
+    this->tombstones_ = 0;
+    graves_.clear();
+}
+
+/**
+* Erases the oldest tombstones first. Nodes revived since they were
+* buried are just dropped from the list.
+*/
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::purgeTombstones(size_t budget)
+{
+    size_t next = 0;
+    for (; next < graves_.size() && budget > 0; ++next) {
+        AVLNode<Key, Value>* n = graves_[next];
+        n->setQueued(false);
+        if (!n->isDead()) continue;
+        unlinkNode(n);
+        --nodes_;
+        --this->tombstones_;
+        --budget;
+    }
+    graves_.erase(graves_.begin(), graves_.begin() + next);
+    return this->tombstones_;
+}
+
+/*
+  -----------------------------------------------
+  Range erase
+  -----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::eraseRange(const Key& lo, const Key& hi)
+{
+    if (this->compareKeys(lo, hi) >= 0) return 0;
+    Node<Key, Value>* first = this->lowerBoundNode(lo);
+    if (first == NULL || this->compareKeys(first->getKey(), hi) >= 0) return 0;
+
+    if (rankBalanced_) return BinarySearchTree<Key, Value, Compare>::eraseRange(lo, hi);
+
+    size_t count = 0;
+    if (maxDeadFraction_ != 0) {
+        for (Node<Key, Value>* n = first; n != NULL && this->compareKeys(n->getKey(), hi) < 0; n = this->successor(n)) {
+            if (n->isDead()) continue;
+            bury(static_cast<AVLNode<Key, Value>*>(n));
+            ++count;
+        }
+        this->resetEnds();
+        if (this->tombstones_ > maxDeadFraction_ * nodes_) rebuild();
+        return count;
+    }
+
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    AVLNode<Key, Value>* left;
+    AVLNode<Key, Value>* rest;
+    AVLNode<Key, Value>* middle;
+    AVLNode<Key, Value>* right;
+    int leftHeight, restHeight, middleHeight, rightHeight;
+    splitAt(root, spineHeight(root), lo, left, leftHeight, rest, restHeight);
+    splitAt(rest, restHeight, hi, middle, middleHeight, right, rightHeight);
+
+    this->freeSubtree(middle, [this, &count](Node<Key, Value>* n) {
+        if (n == finger_) finger_ = NULL;
+        this->destroyNode(n);
+        ++count;
+    });
+
+    // Join the two sides around the smallest key on the right
+    if (right == NULL) {
+        root = left;
+    } else {
+        AVLNode<Key, Value>* rightRest;
+        int rightRestHeight, height;
+        AVLNode<Key, Value>* mid = splitMin(right, rightHeight, rightRest, rightRestHeight);
+        root = join(left, leftHeight, mid, rightRest, rightRestHeight, height);
+    }
+    this->root_ = root;
+    nodes_ -= count;
+    this->resetEnds();
+    return count;
+}
+
+/**
+* Height of an AVL subtree, following the taller child down in O(log n)
+*/
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::spineHeight(AVLNode<Key, Value>* n)
+{
+    int height = 0;
+    for (; n != NULL; n = (n->getBalance() < 0) ? n->getLeft() : n->getRight()) ++height;
+    return height;
+}
+
+/**
+* If the heights differ by more than one, mid replaces the first node c on
+* the taller tree's inner spine that is at most one taller than the
+* shorter tree, taking c and the shorter tree as its children. That grows
+* the spine by one level, exactly like an insert there, so insertFix
+* restores the balances on the way up. The tree grew only if the fix
+* reached its old root without a rotation, turning a 0 balance into a
+* lean towards mid.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::join(AVLNode<Key, Value>* left, int leftHeight, AVLNode<Key, Value>* mid,
+                                                        AVLNode<Key, Value>* right, int rightHeight, int& height)
+{
+    if (leftHeight <= rightHeight + 1 && rightHeight <= leftHeight + 1) {
+        mid->setLeft(left);
+        mid->setRight(right);
+        if (left != NULL) left->setParent(mid);
+        if (right != NULL) right->setParent(mid);
+        mid->setParent(NULL);
+        mid->setBalance(rightHeight - leftHeight);
+        joined(mid);
+        height = std::max(leftHeight, rightHeight) + 1;
+        return mid;
+    }
+
+    bool leftTaller = leftHeight > rightHeight;
+    AVLNode<Key, Value>* top = leftTaller ? left : right;
+    int8_t topBalance = top->getBalance();
+    int shortHeight = leftTaller ? rightHeight : leftHeight;
+    int h = leftTaller ? leftHeight : rightHeight;
+
+    AVLNode<Key, Value>* parent = NULL;
+    AVLNode<Key, Value>* c = top;
+    while (h > shortHeight + 1) {
+        parent = c;
+        if (leftTaller) {
+            h -= (c->getBalance() < 0) ? 2 : 1;
+            c = c->getRight();
+        } else {
+            h -= (c->getBalance() > 0) ? 2 : 1;
+            c = c->getLeft();
+        }
+    }
+
+    if (leftTaller) {
+        mid->setLeft(c);
+        mid->setRight(right);
+        if (right != NULL) right->setParent(mid);
+        mid->setBalance(shortHeight - h);
+        parent->setRight(mid);
+    } else {
+        mid->setLeft(left);
+        mid->setRight(c);
+        if (left != NULL) left->setParent(mid);
+        mid->setBalance(h - shortHeight);
+        parent->setLeft(mid);
+    }
+    if (c != NULL) c->setParent(mid);
+    mid->setParent(parent);
+    joined(mid);
+    insertFix(mid, parent, (mid->getBalance() < 0) ? mid->getLeft() : mid->getRight());
+
+    // Rotations refreshed the nodes they moved; the rest of the path up
+    // is refreshed here. Rotating at the top set root_, which the caller
+    // overwrites once done.
+    AVLNode<Key, Value>* root = mid;
+    while (root->getParent() != NULL) {
+        root = root->getParent();
+        joined(root);
+    }
+    bool grew = (root == top && topBalance == 0 && top->getBalance() == (leftTaller ? 1 : -1));
+    height = (leftTaller ? leftHeight : rightHeight) + (grew ? 1 : 0);
+    return root;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::splitAt(AVLNode<Key, Value>* t, int height, const Key& key,
+                                           AVLNode<Key, Value>*& left, int& leftHeight, AVLNode<Key, Value>*& right, int& rightHeight)
+{
+    if (t == NULL) {
+        left = right = NULL;
+        leftHeight = rightHeight = 0;
+        return;
+    }
+
+    AVLNode<Key, Value>* l = t->getLeft();
+    AVLNode<Key, Value>* r = t->getRight();
+    int lh = height - (t->getBalance() > 0 ? 2 : 1);
+    int rh = height - (t->getBalance() < 0 ? 2 : 1);
+    if (l != NULL) l->setParent(NULL);
+    if (r != NULL) r->setParent(NULL);
+
+    if (this->compareKeys(t->getKey(), key) < 0) {
+        AVLNode<Key, Value>* between;
+        int betweenHeight;
+        splitAt(r, rh, key, between, betweenHeight, right, rightHeight);
+        left = join(l, lh, t, between, betweenHeight, leftHeight);
+    } else {
+        AVLNode<Key, Value>* between;
+        int betweenHeight;
+        splitAt(l, lh, key, left, leftHeight, between, betweenHeight);
+        right = join(between, betweenHeight, t, r, rh, rightHeight);
+    }
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::splitMin(AVLNode<Key, Value>* t, int height,
+                                                            AVLNode<Key, Value>*& rest, int& restHeight)
+{
+    AVLNode<Key, Value>* l = t->getLeft();
+    AVLNode<Key, Value>* r = t->getRight();
+    int rh = height - (t->getBalance() < 0 ? 2 : 1);
+    if (r != NULL) r->setParent(NULL);
+    t->setRight(NULL);
+
+    if (l == NULL) {
+        rest = r;
+        restHeight = rh;
+        return t;
+    }
+
+    int lh = height - (t->getBalance() > 0 ? 2 : 1);
+    l->setParent(NULL);
+    t->setLeft(NULL);
+    AVLNode<Key, Value>* leftRest;
+    int leftRestHeight;
+    AVLNode<Key, Value>* min = splitMin(l, lh, leftRest, leftRestHeight);
+    rest = join(leftRest, leftRestHeight, t, r, rh, restHeight);
+    return min;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::joined(AVLNode<Key, Value>*)
+{
+
+}
+
+/**
+* linkBalanced builds subtrees whose heights differ by at most one, which
+* is a valid AVL balance and, with rank = height - 1, a valid WAVL rank.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::relinked(Node<Key, Value>* n, int leftHeight, int rightHeight)
+{
+    AVLNode<Key, Value>* a = static_cast<AVLNode<Key, Value>*>(n);
+    a->setBalance(rightHeight - leftHeight);
+    a->setRank(std::max(leftHeight, rightHeight));
+}
+
+/*
+  -----------------------------------------------
+  Compaction
+  -----------------------------------------------
+*/
+
+/**
+* Copies the nodes into the block in three passes: place each copy, then
+* leave a forwarding pointer in the original's parent field, then rewrite
+* every copy's links through those forwards. The originals are freed last,
+* which also frees the previous block since every node in it has moved.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::compact(NodeOrder order)
+{
+    if (this->root_ == NULL) return;
+
+    std::vector<AVLNode<Key, Value>*> nodes;
+    nodes.reserve(nodes_);
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    if (order == BREADTH_FIRST) {
+        nodes.push_back(root);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i]->getLeft() != NULL) nodes.push_back(nodes[i]->getLeft());
+            if (nodes[i]->getRight() != NULL) nodes.push_back(nodes[i]->getRight());
+        }
+    } else if (order == VAN_EMDE_BOAS) {
+        vebOrder(root, height(), nodes);
+    } else {
+        // In order without successor(), which the forwarding would break
+        std::vector<AVLNode<Key, Value>*> pending;
+        AVLNode<Key, Value>* current = root;
+        while (current != NULL || !pending.empty()) {
+            while (current != NULL) {
+                pending.push_back(current);
+                current = current->getLeft();
+            }
+            current = pending.back();
+            pending.pop_back();
+            nodes.push_back(current);
+            current = current->getRight();
+        }
+    }
+
+    size_t stride = nodeBytes();
+    size_t bytes = stride * nodes.size();
+    char* block = static_cast<char*>(::operator new(bytes));
+    std::vector<AVLNode<Key, Value>*> moved(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        moved[i] = relocateNode(nodes[i], block + i * stride);
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nodes[i]->setParent(moved[i]);
+    }
+    for (size_t i = 0; i < moved.size(); ++i) {
+        AVLNode<Key, Value>* n = moved[i];
+        if (n->getParent() != NULL) n->setParent(n->getParent()->getParent());
+        if (n->getLeft() != NULL) n->setLeft(n->getLeft()->getParent());
+        if (n->getRight() != NULL) n->setRight(n->getRight()->getParent());
+    }
+
+    this->root_ = this->root_->getParent();
+    // A tree holding only tombstones has no ends
+    if (this->minNode_ != NULL) {
+        this->minNode_ = this->minNode_->getParent();
+        this->maxNode_ = this->maxNode_->getParent();
+    }
+    if (finger_ != NULL) finger_ = finger_->getParent();
+    for (size_t i = 0; i < graves_.size(); ++i) {
+        graves_[i] = graves_[i]->getParent();
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        this->destroyNode(nodes[i]);
+    }
+    block_ = block;
+    blockBytes_ = bytes;
+    blockLive_ = moved.size();
+}
+
+/**
+* Hands the block to the task along with the nodes, so nodes inside it
+* are only destroyed there and the block is freed last.
+*/
+template<class Key, class Value, class Compare>
+std::function<void()> AVLTree<Key, Value, Compare>::detachNodes()
+{
+    Node<Key, Value>* old = this->root_;
+    char* block = block_;
+    size_t bytes = blockBytes_;
+    this->root_ = NULL;
+    block_ = NULL;
+    blockBytes_ = 0;
+    blockLive_ = 0;
+    this->clear();
+    if (old == NULL) return std::function<void()>();
+    return [old, block, bytes]() {
+        BinarySearchTree<Key, Value, Compare>::freeSubtree(old, [block, bytes](Node<Key, Value>* n) {
+            if (inBlock(block, bytes, n)) n->~Node<Key, Value>();
+            else delete n;
+        });
+        ::operator delete(block);
+    };
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::nodeBytes() const
+{
+    return sizeof(AVLNode<Key, Value>);
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::relocateNode(AVLNode<Key, Value>* n, void* slot) const
+{
+    return new (slot) AVLNode<Key, Value>(*n);
+}
+
+/**
+* Recursion depth is O(log levels). Finding the bottom subtrees walks the
+* top part again, which is where the log log n factor comes from.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::vebOrder(AVLNode<Key, Value>* t, int levels, std::vector<AVLNode<Key, Value>*>& out)
+{
+    if (t == NULL) return;
+    if (levels == 1) {
+        out.push_back(t);
+        return;
+    }
+    int top = levels / 2;
+    vebOrder(t, top, out);
+
+    // Roots of the bottom subtrees, left to right, at depth top below t
+    std::vector<std::pair<AVLNode<Key, Value>*, int> > pending;
+    pending.push_back(std::make_pair(t, 0));
+    while (!pending.empty()) {
+        AVLNode<Key, Value>* n = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+        if (depth == top) {
+            vebOrder(n, levels - top, out);
+            continue;
+        }
+        if (n->getRight() != NULL) pending.push_back(std::make_pair(n->getRight(), depth + 1));
+        if (n->getLeft() != NULL) pending.push_back(std::make_pair(n->getLeft(), depth + 1));
+    }
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::releaseNode(Node<Key, Value>* n)
+{
+    if (!inBlock(block_, blockBytes_, n)) {
+        delete n;
+        return;
+    }
+    n->~Node<Key, Value>();
+    if (--blockLive_ == 0) {
+        ::operator delete(block_);
+        block_ = NULL;
+        blockBytes_ = 0;
+    }
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::inBlock(const char* block, size_t bytes, const Node<Key, Value>* n)
+{
+    const char* p = reinterpret_cast<const char*>(n);
+    return block != NULL && !std::less<const char*>()(p, block) && std::less<const char*>()(p, block + bytes);
+}
+
+/*
+  -----------------------------------------------
+  Rank-balanced (WAVL) mode
+  -----------------------------------------------
+*/
+
+/**
+* Rank of a node; missing children have rank -1.
+*/
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::rank(AVLNode<Key, Value>* n)
+{
+    return (n == NULL) ? -1 : n->getRank();
+}
+
+/**
+* Inserts below current, which insertFrom guarantees is non-NULL.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::WAVLinsert(AVLNode<Key, Value>* current, const std::pair<const Key, Value>& new_item)
+{
+    int c;
+    while (true) {
+        c = this->compareKeys(new_item.first, current->getKey());
+        ++searchComparisons_;
+        if (c == 0) {
+            current->setValue(new_item.second);
+            return current;
+        }
+        AVLNode<Key, Value>* next = (c < 0) ? current->getLeft() : current->getRight();
+        if (next == NULL) break;
+        current = next;
+    }
+
+    // New leaves have rank 0
+    AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, current);
+    ++nodes_;
+    if (c < 0) {
+        current->setLeft(newNode);
+    } else {
+        current->setRight(newNode);
+    }
+    WAVLinsertFix(newNode);
+    return newNode;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::WAVLinsertFix(AVLNode<Key, Value>* child)
+{
+    AVLNode<Key, Value>* parent = child->getParent();
+
+    // Loop while child is a 0-child (same rank as its parent)
+    while (parent != NULL && rank(parent) == rank(child)) {
+        bool childIsLeft = (parent->getLeft() == child);
+        AVLNode<Key, Value>* sibling = childIsLeft ? parent->getRight() : parent->getLeft();
+
+        // Case 1: parent is 0,1 - promote it and continue upwards
+        if (rank(parent) - rank(sibling) == 1) {
+            parent->setRank(parent->getRank() + 1);
+            child = parent;
+            parent = child->getParent();
+            continue;
+        }
+
+        // Parent is 0,2: one or two rotations finish the insert
+        AVLNode<Key, Value>* inner = childIsLeft ? child->getRight() : child->getLeft();
+
+        // Case 2: inner grandchild is a 2-child - single rotation
+        if (rank(child) - rank(inner) == 2) {
+            if (childIsLeft) rightRotate(parent, child);
+            else leftRotate(parent, child);
+            parent->setRank(parent->getRank() - 1);
+        }
+        // Case 3: inner grandchild is a 1-child - double rotation
+        else {
+            if (childIsLeft) {
+                leftRotate(child, inner);
+                rightRotate(parent, inner);
+            } else {
+                rightRotate(child, inner);
+                leftRotate(parent, inner);
+            }
+            inner->setRank(inner->getRank() + 1);
+            child->setRank(child->getRank() - 1);
+            parent->setRank(parent->getRank() - 1);
+        }
+        return;
+    }
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::WAVLerase(AVLNode<Key, Value>* current)
+{
+    // Two children case: swap with predecessor (ranks stay with positions)
+    if (current->getLeft() != NULL && current->getRight() != NULL) {
+        nodeSwap(current, static_cast<AVLNode<Key, Value>*>(this->predecessor(current)));
+    }
+
+    // current now has at most one child, which takes its place
+    AVLNode<Key, Value>* parent = current->getParent();
+    AVLNode<Key, Value>* child = (current->getLeft() != NULL) ? current->getLeft() : current->getRight();
+    if (child != NULL) {
+        this->promoteNode(current, parent, child);
+    } else {
+        this->removeNode(current);
+    }
+    WAVLremoveFix(child, parent);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::WAVLremoveFix(AVLNode<Key, Value>* child, AVLNode<Key, Value>* parent)
+{
+    if (parent == NULL) return;
+
+    // Removing a leaf can leave parent as a 2,2 leaf: demote it to rank 0
+    if (parent->getLeft() == NULL && parent->getRight() == NULL && parent->getRank() == 1) {
+        parent->setRank(0);
+        child = parent;
+        parent = child->getParent();
+    }
+
+    // Loop while child is a 3-child. child may be NULL, but then the parent's
+    // other child is not (parent is not a leaf), so the side is unambiguous.
+    while (parent != NULL && rank(parent) - rank(child) == 3) {
+        bool childIsLeft = (parent->getLeft() == child);
+        AVLNode<Key, Value>* sibling = childIsLeft ? parent->getRight() : parent->getLeft();
+
+        // Case 1: sibling is a 2-child - demote parent and continue upwards
+        if (rank(parent) - rank(sibling) == 2) {
+            parent->setRank(parent->getRank() - 1);
+            child = parent;
+            parent = child->getParent();
+            continue;
+        }
+
+        AVLNode<Key, Value>* outer = childIsLeft ? sibling->getRight() : sibling->getLeft();
+        AVLNode<Key, Value>* inner = childIsLeft ? sibling->getLeft() : sibling->getRight();
+
+        // Case 2: sibling is 2,2 - demote parent and sibling, continue upwards
+        if (rank(sibling) - rank(outer) == 2 && rank(sibling) - rank(inner) == 2) {
+            parent->setRank(parent->getRank() - 1);
+            sibling->setRank(sibling->getRank() - 1);
+            child = parent;
+            parent = child->getParent();
+            continue;
+        }
+
+        // Case 3: outer nephew is a 1-child - single rotation
+        if (rank(sibling) - rank(outer) == 1) {
+            if (childIsLeft) leftRotate(parent, sibling);
+            else rightRotate(parent, sibling);
+            sibling->setRank(sibling->getRank() + 1);
+            parent->setRank(parent->getRank() - 1);
+            if (parent->getLeft() == NULL && parent->getRight() == NULL) {
+                parent->setRank(0);
+            }
+        }
+        // Case 4: inner nephew is a 1-child - double rotation
+        else {
+            if (childIsLeft) {
+                rightRotate(sibling, inner);
+                leftRotate(parent, inner);
+            } else {
+                leftRotate(sibling, inner);
+                rightRotate(parent, inner);
+            }
+            inner->setRank(inner->getRank() + 2);
+            sibling->setRank(sibling->getRank() - 1);
+            parent->setRank(parent->getRank() - 2);
+        }
+        return;
+    }
 }
 
 
@@ -0,0 +1,448 @@
+#ifndef AVLMULTIMAP_H
+#define AVLMULTIMAP_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <utility>
+#include "avlbst.h"
+
+/**
+* An AVL node that also records how many nodes are in its subtree
+* (itself included), so the tree can rank keys in O(log n).
+*/
+template <typename Key, typename Value>
+class AVLMultiNode : public AVLNode<Key, Value>
+{
+public:
+    AVLMultiNode(const Key& key, const Value& value, AVLMultiNode<Key, Value>* parent);
+    virtual ~AVLMultiNode();
+
+    // Getter/setter for the subtree size
+    size_t getSize() const;
+    void setSize(size_t size);
+
+    // Recomputes size_ from the children's sizes
+    void updateSize();
+
+    // Size of a possibly missing subtree
+    static size_t sizeOf(Node<Key, Value>* n);
+
+protected:
+    size_t size_;
+};
+
+template<class Key, class Value>
+AVLMultiNode<Key, Value>::AVLMultiNode(const Key& key, const Value& value, AVLMultiNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), size_(1)
+{
+
+}
+
+template<class Key, class Value>
+AVLMultiNode<Key, Value>::~AVLMultiNode()
+{
+
+}
+
+template<class Key, class Value>
+size_t AVLMultiNode<Key, Value>::getSize() const
+{
+    return size_;
+}
+
+template<class Key, class Value>
+void AVLMultiNode<Key, Value>::setSize(size_t size)
+{
+    size_ = size;
+}
+
+template<class Key, class Value>
+void AVLMultiNode<Key, Value>::updateSize()
+{
+    size_ = 1 + sizeOf(this->getLeft()) + sizeOf(this->getRight());
+}
+
+template<class Key, class Value>
+size_t AVLMultiNode<Key, Value>::sizeOf(Node<Key, Value>* n)
+{
+    return (n == NULL) ? 0 : static_cast<AVLMultiNode<Key, Value>*>(n)->getSize();
+}
+
+
+/**
+* An AVL tree that keeps every inserted item, including items whose keys
+* are already present. Each duplicate is its own node; equal keys are
+* kept in insertion order, so iteration visits them oldest first.
+*
+* Every node stores its subtree size, which the rotations keep current
+* through the rotated() hook. count() and the rank queries therefore take
+* O(log n) no matter how many copies of a key there are.
+*
+* find() and operator[] return the first (oldest) item with the key;
+* remove(key) removes all of them and erase(it) removes just one.
+* Always runs in plain AVL mode, and removes are never lazy.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class AVLMultiMap : public AVLTree<Key, Value, Compare>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+
+    explicit AVLMultiMap(const Compare& comp = Compare());
+
+    // Adds the item after any items with an equal key
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+
+    // Removes every item with the key
+    virtual void remove(const Key& key);
+    template<typename K>
+    void remove(const K& key);
+
+    // Removes the single item it points to and returns the next one
+    iterator erase(iterator it);
+
+    // First item with the key, or end()
+    iterator find(const Key& key) const;
+    template<typename K>
+    iterator find(const K& key) const;
+    // Value of the first item with the key; throws std::out_of_range if
+    // there is none
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    // Removes are never lazy here: a tombstone would still count in the
+    // subtree sizes
+    void setTombstones(double maxDeadFraction) = delete;
+
+    // First item whose key is greater than key, or end()
+    template<typename K>
+    iterator upper_bound(const K& key) const;
+
+    // [lower_bound(key), upper_bound(key))
+    template<typename K>
+    std::pair<iterator, iterator> equal_range(const K& key) const;
+
+    // Number of items with the key
+    template<typename K>
+    size_t count(const K& key) const;
+
+    // Number of items whose key is less than key
+    template<typename K>
+    size_t countLess(const K& key) const;
+
+    // Number of items with lo <= key < hi, in O(log n) from the sizes
+    size_t countRange(const Key& lo, const Key& hi) const;
+
+    // Number of items in the tree
+    size_t size() const;
+
+    // Copies shape, balances and subtree sizes node by node in O(n)
+    AVLMultiMap clone() const;
+
+protected:
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual void nodeSwap(AVLNode<Key, Value>* n1, AVLNode<Key, Value>* n2);
+    virtual void rotated(Node<Key, Value>* down, Node<Key, Value>* up);
+    virtual void relinked(Node<Key, Value>* n, int leftHeight, int rightHeight);
+    virtual void joined(AVLNode<Key, Value>* n);
+    virtual Node<Key, Value>* copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const;
+    virtual size_t nodeBytes() const;
+    virtual AVLNode<Key, Value>* relocateNode(AVLNode<Key, Value>* n, void* slot) const;
+
+    // Number of items whose key is less than key, or not greater if inclusive
+    template<typename K>
+    size_t rankOf(const K& key, bool inclusive) const;
+
+    template<typename K>
+    Node<Key, Value>* upperBoundNode(const K& key) const;
+};
+
+template<class Key, class Value, class Compare>
+AVLMultiMap<Key, Value, Compare>::AVLMultiMap(const Compare& comp) :
+    AVLTree<Key, Value, Compare>(false, comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLMultiMap<Key, Value, Compare> AVLMultiMap<Key, Value, Compare>::clone() const
+{
+    AVLMultiMap<Key, Value, Compare> copy(this->comp_);
+    this->copyInto(copy);
+    return copy;
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* AVLMultiMap<Key, Value, Compare>::copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const
+{
+    const AVLMultiNode<Key, Value>* from = static_cast<const AVLMultiNode<Key, Value>*>(n);
+    AVLMultiNode<Key, Value>* to = new AVLMultiNode<Key, Value>(from->getKey(), from->getValue(),
+                                                                static_cast<AVLMultiNode<Key, Value>*>(parent));
+    this->copyAVLNode(from, to);
+    to->setSize(from->getSize());
+    return to;
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLMultiMap<Key, Value, Compare>::nodeBytes() const
+{
+    return sizeof(AVLMultiNode<Key, Value>);
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLMultiMap<Key, Value, Compare>::relocateNode(AVLNode<Key, Value>* n, void* slot) const
+{
+    return new (slot) AVLMultiNode<Key, Value>(*static_cast<AVLMultiNode<Key, Value>*>(n));
+}
+
+/**
+* Descends iteratively, sending equal keys right, then bumps the sizes on
+* the path before rebalancing so the rotations see consistent counts.
+*/
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::insert(const std::pair<const Key, Value>& new_item)
+{
+    AVLMultiNode<Key, Value>* current = static_cast<AVLMultiNode<Key, Value>*>(this->root_);
+    if (current == NULL) {
+        this->root_ = new AVLMultiNode<Key, Value>(new_item.first, new_item.second, NULL);
+        this->noteInserted(this->root_);
+        this->nodes_ = 1;
+        return;
+    }
+
+    bool left = false;
+    while (true) {
+        left = this->compareKeys(new_item.first, current->getKey()) < 0;
+        Node<Key, Value>* next = left ? current->getLeft() : current->getRight();
+        if (next == NULL) break;
+        current = static_cast<AVLMultiNode<Key, Value>*>(next);
+    }
+
+    AVLMultiNode<Key, Value>* newNode = new AVLMultiNode<Key, Value>(new_item.first, new_item.second, current);
+    this->noteInserted(newNode);
+    ++this->nodes_;
+    for (Node<Key, Value>* p = current; p != NULL; p = p->getParent()) {
+        AVLMultiNode<Key, Value>* m = static_cast<AVLMultiNode<Key, Value>*>(p);
+        m->setSize(m->getSize() + 1);
+    }
+
+    // Same balance update as AVLinsertHelper once the leaf is attached
+    if (left) {
+        current->setLeft(newNode);
+        if (current->getBalance() == 1) {
+            current->setBalance(0);
+        } else if (current->getBalance() == 0) {
+            current->setBalance(-1);
+            this->insertFix(current, current->getParent(), newNode);
+        }
+    } else {
+        current->setRight(newNode);
+        if (current->getBalance() == -1) {
+            current->setBalance(0);
+        } else if (current->getBalance() == 0) {
+            current->setBalance(1);
+            this->insertFix(current, current->getParent(), newNode);
+        }
+    }
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::remove(const Key& key)
+{
+    Node<Key, Value>* current;
+    while ((current = this->findNode(key)) != NULL) {
+        eraseNode(current);
+    }
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+void AVLMultiMap<Key, Value, Compare>::remove(const K& key)
+{
+    Node<Key, Value>* current;
+    while ((current = this->findNode(key)) != NULL) {
+        eraseNode(current);
+    }
+}
+
+/**
+* Nodes are relinked rather than copied on removal, so the successor
+* taken beforehand is still valid afterwards.
+*/
+template<class Key, class Value, class Compare>
+typename AVLMultiMap<Key, Value, Compare>::iterator
+AVLMultiMap<Key, Value, Compare>::erase(iterator it)
+{
+    Node<Key, Value>* current = this->iteratorNode(it);
+    if (current == NULL) return it;
+    Node<Key, Value>* next = this->successor(current);
+    eraseNode(current);
+    return this->makeIterator(next);
+}
+
+template<class Key, class Value, class Compare>
+typename AVLMultiMap<Key, Value, Compare>::iterator
+AVLMultiMap<Key, Value, Compare>::find(const Key& key) const
+{
+    return find<Key>(key);
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+typename AVLMultiMap<Key, Value, Compare>::iterator
+AVLMultiMap<Key, Value, Compare>::find(const K& key) const
+{
+    Node<Key, Value>* current = this->lowerBoundNode(key);
+    if (current != NULL && this->compareKeys(key, current->getKey()) != 0) current = NULL;
+    return this->makeIterator(current);
+}
+
+template<class Key, class Value, class Compare>
+Value& AVLMultiMap<Key, Value, Compare>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if (it == this->end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+template<class Key, class Value, class Compare>
+Value const & AVLMultiMap<Key, Value, Compare>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if (it == this->end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+typename AVLMultiMap<Key, Value, Compare>::iterator
+AVLMultiMap<Key, Value, Compare>::upper_bound(const K& key) const
+{
+    return this->makeIterator(upperBoundNode(key));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+std::pair<typename AVLMultiMap<Key, Value, Compare>::iterator, typename AVLMultiMap<Key, Value, Compare>::iterator>
+AVLMultiMap<Key, Value, Compare>::equal_range(const K& key) const
+{
+    return std::make_pair(this->makeIterator(this->lowerBoundNode(key)), this->makeIterator(upperBoundNode(key)));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+size_t AVLMultiMap<Key, Value, Compare>::count(const K& key) const
+{
+    return rankOf(key, true) - rankOf(key, false);
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+size_t AVLMultiMap<Key, Value, Compare>::countLess(const K& key) const
+{
+    return rankOf(key, false);
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLMultiMap<Key, Value, Compare>::countRange(const Key& lo, const Key& hi) const
+{
+    if (this->compareKeys(lo, hi) >= 0) return 0;
+    return rankOf(hi, false) - rankOf(lo, false);
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLMultiMap<Key, Value, Compare>::size() const
+{
+    return AVLMultiNode<Key, Value>::sizeOf(this->root_);
+}
+
+/**
+* The node that physically leaves the tree is the predecessor when the
+* node has two children (AVLTree::unlinkNode swaps them first), otherwise
+* the node itself. Its ancestors each lose one item; nodeSwap carries the
+* adjusted size along, and removeFix's rotations recompute the rest.
+*/
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::eraseNode(Node<Key, Value>* node)
+{
+    this->noteErasing(node);
+    Node<Key, Value>* leaving = node;
+    if (node->getLeft() != NULL && node->getRight() != NULL) {
+        leaving = this->predecessor(node);
+    }
+    for (Node<Key, Value>* p = leaving->getParent(); p != NULL; p = p->getParent()) {
+        AVLMultiNode<Key, Value>* m = static_cast<AVLMultiNode<Key, Value>*>(p);
+        m->setSize(m->getSize() - 1);
+    }
+    this->unlinkNode(static_cast<AVLNode<Key, Value>*>(node));
+    --this->nodes_;
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::nodeSwap(AVLNode<Key, Value>* n1, AVLNode<Key, Value>* n2)
+{
+    AVLTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    AVLMultiNode<Key, Value>* m1 = static_cast<AVLMultiNode<Key, Value>*>(n1);
+    AVLMultiNode<Key, Value>* m2 = static_cast<AVLMultiNode<Key, Value>*>(n2);
+    size_t temp = m1->getSize();
+    m1->setSize(m2->getSize());
+    m2->setSize(temp);
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::rotated(Node<Key, Value>* down, Node<Key, Value>* up)
+{
+    static_cast<AVLMultiNode<Key, Value>*>(down)->updateSize();
+    static_cast<AVLMultiNode<Key, Value>*>(up)->updateSize();
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::relinked(Node<Key, Value>* n, int leftHeight, int rightHeight)
+{
+    AVLTree<Key, Value, Compare>::relinked(n, leftHeight, rightHeight);
+    static_cast<AVLMultiNode<Key, Value>*>(n)->updateSize();
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::joined(AVLNode<Key, Value>* n)
+{
+    static_cast<AVLMultiNode<Key, Value>*>(n)->updateSize();
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+size_t AVLMultiMap<Key, Value, Compare>::rankOf(const K& key, bool inclusive) const
+{
+    size_t rank = 0;
+    Node<Key, Value>* current = this->root_;
+    while (current != NULL) {
+        int c = this->compareKeys(current->getKey(), key);
+        if (c < 0 || (inclusive && c == 0)) {
+            rank += AVLMultiNode<Key, Value>::sizeOf(current->getLeft()) + 1;
+            current = current->getRight();
+        } else {
+            current = current->getLeft();
+        }
+    }
+    return rank;
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+Node<Key, Value>* AVLMultiMap<Key, Value, Compare>::upperBoundNode(const K& key) const
+{
+    Node<Key, Value>* candidate = NULL;
+    Node<Key, Value>* current = this->root_;
+    while (current != NULL) {
+        if (this->compareKeys(key, current->getKey()) < 0) {
+            candidate = current;
+            current = current->getLeft();
+        } else {
+            current = current->getRight();
+        }
+    }
+    return candidate;
+}
+
+#endif
@@ -0,0 +1,721 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "splaybst.h"
+#include "treap.h"
+#include "artmap.h"
+#include "rbbst.h"
+
+using namespace std;
+
+/**
+ * Microbenchmark suite for the map implementations.
+ *
+ * Measures insert, find, remove, full iteration, mixed insert/remove and
+ * sorted bulk-build throughput of BinarySearchTree, AVLTree (also in WAVL
+ * and finger-search modes), SplayTree, RedBlackTree, Treap, the ArtMap radix tree and
+ * std::map over several key distributions and tree sizes, and writes the
+ * results (with rotations per operation for the trees in this repository)
+ * as JSON so they can be tracked across releases.
+ *
+ * For AVLTree it also times find and iteration on a tree whose nodes were
+ * scattered by a mixed insert/remove stream, then again after compact()
+ * in each node order (bfs, veb, inorder), along with compact() itself,
+ * and times find with the lookup cache off and at several sizes.
+ *
+ * Each result records "n", the number of keys inserted to build the
+ * tree, and "size", the number of items the built tree holds; they differ
+ * when the distribution repeats keys (zipfian).  "ops" is the number of
+ * operations timed, so for iterate it is the items actually visited.
+ *
+ * Usage: bst-bench [--min-size N] [--max-size N] [--trees a,b,...]
+ *                  [--dists a,b,...] [--seed S] [--degenerate-cap N]
+ *                  [--out FILE]
+ *
+ * Trees: bst, avl, wavl, avl-finger, rb, splay, treap, art, map.
+ * Distributions: sequential, random, zipfian, adversarial, nearly-sorted.
+ *
+ * Sizes run in powers of ten from --min-size (default 1e3) up to
+ * --max-size (default 1e6, at most 1e8).  The unbalanced tree becomes
+ * a linked list on sequential, adversarial and nearly sorted keys, so
+ * those runs are skipped above --degenerate-cap (default 1e4) and
+ * reported as such.
+ */
+
+typedef uint64_t BenchKey;
+typedef uint64_t BenchValue;
+
+// AVLTree in rank-balanced (WAVL) mode, default-constructible for runOne
+class WAVLTree : public AVLTree<BenchKey, BenchValue>
+{
+public:
+    WAVLTree() : AVLTree<BenchKey, BenchValue>(true) {}
+};
+
+// AVLTree inserting from the previous insertion point
+class FingerAVLTree : public AVLTree<BenchKey, BenchValue>
+{
+public:
+    FingerAVLTree() { setFingerSearch(true); }
+};
+
+// Total number of operations each measurement should cover at least;
+// small trees are rebuilt and re-measured until this many are done.
+static const size_t MIN_OPS_PER_SAMPLE = 1000000;
+
+// Largest supported tree size
+static const size_t MAX_TREE_SIZE = 100000000;
+
+enum Distribution { SEQUENTIAL, RANDOM, ZIPFIAN, ADVERSARIAL, NEARLY_SORTED };
+
+static const char* const DIST_NAMES[] = { "sequential", "random", "zipfian", "adversarial", "nearly-sorted" };
+
+/**
+ * Zipfian rank generator (Gray et al., "Quickly Generating Billion-Record
+ * Synthetic Databases").  Setup is O(n) to compute zeta(n), sampling is O(1),
+ * so it scales to the largest tree sizes without a CDF table.
+ * Returns ranks in [0, n), with rank 0 the most popular.
+ */
+class ZipfianGenerator
+{
+public:
+    ZipfianGenerator(uint64_t n, double theta, uint32_t seed) :
+        n_(n), theta_(theta), rng_(seed), uniform_(0.0, 1.0)
+    {
+        zetan_ = zeta(n, theta);
+        double zeta2 = zeta(2, theta);
+        alpha_ = 1.0 / (1.0 - theta);
+        eta_ = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan_);
+    }
+
+    uint64_t next()
+    {
+        double u = uniform_(rng_);
+        double uz = u * zetan_;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_)) return 1;
+        uint64_t rank = (uint64_t)(n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return rank < n_ ? rank : n_ - 1;
+    }
+
+private:
+    static double zeta(uint64_t n, double theta)
+    {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow((double)i, theta);
+        }
+        return sum;
+    }
+
+    uint64_t n_;
+    double theta_;
+    double zetan_;
+    double alpha_;
+    double eta_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> uniform_;
+};
+
+// Maps a rank onto a key so that popular keys are spread over the key space
+// instead of clustering at the low end.  Multiplication by an odd constant is
+// a bijection on 64-bit integers, so distinct ranks stay distinct keys.
+static BenchKey scatter(uint64_t rank)
+{
+    return rank * 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+ * Returns the key sequence used to build a tree of n entries.
+ *  sequential:  0, 1, 2, ... (ascending)
+ *  random:      a random permutation of n scattered keys
+ *  zipfian:     n draws from a Zipf(0.99) distribution over n scattered keys,
+ *               so hot keys are inserted (overwritten) many times
+ *  adversarial: alternating extremes 0, n-1, 1, n-2, ... which turns the
+ *               unbalanced tree into a zig-zag path and makes every AVL
+ *               insert rebalance
+ *  nearly-sorted: ascending, but about 1 key in 16 swapped with one up to
+ *               32 places later, like a time series with late arrivals
+ */
+static vector<BenchKey> makeKeys(Distribution dist, size_t n, uint32_t seed)
+{
+    vector<BenchKey> keys;
+    keys.reserve(n);
+    if (dist == SEQUENTIAL) {
+        for (size_t i = 0; i < n; ++i) keys.push_back(i);
+    } else if (dist == RANDOM) {
+        for (size_t i = 0; i < n; ++i) keys.push_back(scatter(i));
+        std::mt19937_64 rng(seed);
+        std::shuffle(keys.begin(), keys.end(), rng);
+    } else if (dist == ZIPFIAN) {
+        ZipfianGenerator zipf(n, 0.99, seed);
+        for (size_t i = 0; i < n; ++i) keys.push_back(scatter(zipf.next()));
+    } else if (dist == NEARLY_SORTED) {
+        for (size_t i = 0; i < n; ++i) keys.push_back(i);
+        std::mt19937_64 rng(seed);
+        for (size_t i = 0; i < n; ++i) {
+            if (rng() % 16 != 0) continue;
+            size_t j = i + 1 + rng() % 32;
+            if (j < n) std::swap(keys[i], keys[j]);
+        }
+    } else {
+        size_t lo = 0, hi = n;
+        while (lo < hi) {
+            keys.push_back(lo++);
+            if (lo < hi) keys.push_back(--hi);
+        }
+    }
+    return keys;
+}
+
+// Returns the lookup sequence for a tree built from keys: the same
+// distribution drawn again (re-shuffled for random, fresh Zipf draws
+// for zipfian) so lookups follow the access pattern being modelled.
+static vector<BenchKey> makeQueries(Distribution dist, const vector<BenchKey>& keys, uint32_t seed)
+{
+    if (dist == RANDOM) {
+        vector<BenchKey> queries(keys);
+        std::mt19937_64 rng(seed + 1);
+        std::shuffle(queries.begin(), queries.end(), rng);
+        return queries;
+    }
+    if (dist == ZIPFIAN) {
+        return makeKeys(ZIPFIAN, keys.size(), seed + 1);
+    }
+    return keys;
+}
+
+/**
+ * Uniform interface over the benchmarked maps.  The trees in this
+ * repository share the BinarySearchTree API; std::map is adapted below.
+ */
+template<class Tree>
+struct TreeOps
+{
+    static void insert(Tree& t, BenchKey k, BenchValue v) { t.insert(std::make_pair(k, v)); }
+    // Non-const so self-adjusting trees restructure on lookup
+    static BenchValue find(Tree& t, BenchKey k)
+    {
+        typename Tree::iterator it = t.find(k);
+        return it == t.end() ? 0 : it->second;
+    }
+    static void remove(Tree& t, BenchKey k) { t.remove(k); }
+    // Returns the sum of the values and adds the items visited to visited
+    static BenchValue scan(const Tree& t, size_t& visited)
+    {
+        BenchValue sum = 0;
+        for (typename Tree::iterator it = t.begin(); it != t.end(); ++it, ++visited) sum += it->second;
+        return sum;
+    }
+    static const bool countsRotations = true;
+    static size_t rotations(const Tree& t) { return t.rotationCount(); }
+};
+
+template<>
+struct TreeOps<map<BenchKey, BenchValue> >
+{
+    typedef map<BenchKey, BenchValue> Tree;
+    static void insert(Tree& t, BenchKey k, BenchValue v) { t[k] = v; }
+    static BenchValue find(const Tree& t, BenchKey k)
+    {
+        Tree::const_iterator it = t.find(k);
+        return it == t.end() ? 0 : it->second;
+    }
+    static void remove(Tree& t, BenchKey k) { t.erase(k); }
+    static BenchValue scan(const Tree& t, size_t& visited)
+    {
+        BenchValue sum = 0;
+        for (Tree::const_iterator it = t.begin(); it != t.end(); ++it, ++visited) sum += it->second;
+        return sum;
+    }
+    static const bool countsRotations = false;
+    static size_t rotations(const Tree&) { return 0; }
+};
+
+// ArtMap has the tree API but no rotations
+template<>
+struct TreeOps<ArtMap<BenchKey, BenchValue> >
+{
+    typedef ArtMap<BenchKey, BenchValue> Tree;
+    static void insert(Tree& t, BenchKey k, BenchValue v) { t.insert(std::make_pair(k, v)); }
+    static BenchValue find(const Tree& t, BenchKey k)
+    {
+        Tree::iterator it = t.find(k);
+        return it == t.end() ? 0 : it->second;
+    }
+    static void remove(Tree& t, BenchKey k) { t.remove(k); }
+    static BenchValue scan(const Tree& t, size_t& visited)
+    {
+        BenchValue sum = 0;
+        for (Tree::iterator it = t.begin(); it != t.end(); ++it, ++visited) sum += it->second;
+        return sum;
+    }
+    static const bool countsRotations = false;
+    static size_t rotations(const Tree&) { return 0; }
+};
+
+// Builds a tree from strictly increasing items. Trees without a bulk
+// path insert one at a time; Treap appends along its right spine.
+template<class Tree>
+void bulkLoad(Tree& t, const vector<pair<const BenchKey, BenchValue> >& items)
+{
+    for (size_t i = 0; i < items.size(); ++i) TreeOps<Tree>::insert(t, items[i].first, items[i].second);
+}
+
+static void bulkLoad(Treap<BenchKey, BenchValue>& t, const vector<pair<const BenchKey, BenchValue> >& items)
+{
+    t.insertRange(items.begin(), items.end());
+}
+
+struct BenchResult
+{
+    string tree;
+    string dist;
+    size_t n;               // keys inserted to build the tree
+    size_t size;            // items in the built tree (duplicate keys collapse)
+    string op;
+    size_t ops;
+    double nsPerOp;
+    double rotationsPerOp;  // negative if the tree does not count rotations
+    double hitRate;         // lookup cache hit rate, negative if no cache
+    string skipped;
+};
+
+struct BenchConfig
+{
+    size_t minSize;
+    size_t maxSize;
+    size_t degenerateCap;
+    uint32_t seed;
+    vector<string> trees;
+    vector<string> dists;
+    string out;
+};
+
+// Accumulates results and prevents lookups from being optimized away
+static BenchValue g_sink = 0;
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double elapsedNs(BenchClock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+/**
+ * Returns a mixed update stream for a tree built from keys: alternating
+ * inserts of fresh keys and removes of randomly chosen present keys, so the
+ * tree size stays around its initial size. first is true for inserts.
+ */
+static vector<pair<bool, BenchKey> > makeMixedOps(const vector<BenchKey>& keys, uint32_t seed)
+{
+    vector<BenchKey> present(keys);
+    std::sort(present.begin(), present.end());
+    present.erase(std::unique(present.begin(), present.end()), present.end());
+
+    std::mt19937_64 rng(seed + 2);
+    vector<pair<bool, BenchKey> > ops;
+    ops.reserve(keys.size());
+    uint64_t fresh = keys.size();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i % 2 == 0 || present.empty()) {
+            BenchKey k = scatter(fresh++) + 1;
+            ops.push_back(std::make_pair(true, k));
+            present.push_back(k);
+        } else {
+            size_t idx = rng() % present.size();
+            ops.push_back(std::make_pair(false, present[idx]));
+            present[idx] = present.back();
+            present.pop_back();
+        }
+    }
+    return ops;
+}
+
+/**
+ * Runs insert/find/iterate/remove and a mixed insert/remove stream for one
+ * tree type, distribution and size. Unless it is degenerate (quadratic), the
+ * tree is rebuilt enough times that small sizes still cover
+ * MIN_OPS_PER_SAMPLE operations.
+ */
+template<class Tree>
+void runOne(const string& treeName, Distribution dist, size_t n, uint32_t seed, vector<BenchResult>& results, bool degenerate = false)
+{
+    vector<BenchKey> keys = makeKeys(dist, n, seed);
+    vector<BenchKey> queries = makeQueries(dist, keys, seed);
+    vector<pair<bool, BenchKey> > mixed = makeMixedOps(keys, seed);
+    size_t reps = degenerate ? 1 : std::max<size_t>(1, MIN_OPS_PER_SAMPLE / n);
+
+    enum { INSERT, FIND, ITERATE, REMOVE, MIXED, NUM_PHASES };
+    const char* names[NUM_PHASES] = { "insert", "find", "iterate", "remove", "mixed" };
+    double totals[NUM_PHASES] = { 0 };
+    size_t counts[NUM_PHASES] = { 0 };
+    size_t rotations[NUM_PHASES] = { 0 };
+    size_t size = 0;
+
+    for (size_t r = 0; r < reps; ++r) {
+        Tree* tree = new Tree;
+
+        size_t rot = TreeOps<Tree>::rotations(*tree);
+        BenchClock::time_point start = BenchClock::now();
+        for (size_t i = 0; i < keys.size(); ++i) TreeOps<Tree>::insert(*tree, keys[i], i);
+        totals[INSERT] += elapsedNs(start);
+        counts[INSERT] += keys.size();
+        rotations[INSERT] += TreeOps<Tree>::rotations(*tree) - rot;
+
+        rot = TreeOps<Tree>::rotations(*tree);
+        start = BenchClock::now();
+        for (size_t i = 0; i < queries.size(); ++i) g_sink += TreeOps<Tree>::find(*tree, queries[i]);
+        totals[FIND] += elapsedNs(start);
+        counts[FIND] += queries.size();
+        rotations[FIND] += TreeOps<Tree>::rotations(*tree) - rot;
+
+        size_t visited = 0;
+        start = BenchClock::now();
+        g_sink += TreeOps<Tree>::scan(*tree, visited);
+        totals[ITERATE] += elapsedNs(start);
+        counts[ITERATE] += visited;
+        size = visited;
+
+        rot = TreeOps<Tree>::rotations(*tree);
+        start = BenchClock::now();
+        for (size_t i = 0; i < keys.size(); ++i) TreeOps<Tree>::remove(*tree, keys[i]);
+        totals[REMOVE] += elapsedNs(start);
+        counts[REMOVE] += keys.size();
+        rotations[REMOVE] += TreeOps<Tree>::rotations(*tree) - rot;
+
+        // Mixed stream runs on a freshly built tree (build not timed)
+        for (size_t i = 0; i < keys.size(); ++i) TreeOps<Tree>::insert(*tree, keys[i], i);
+        rot = TreeOps<Tree>::rotations(*tree);
+        start = BenchClock::now();
+        for (size_t i = 0; i < mixed.size(); ++i) {
+            if (mixed[i].first) TreeOps<Tree>::insert(*tree, mixed[i].second, i);
+            else TreeOps<Tree>::remove(*tree, mixed[i].second);
+        }
+        totals[MIXED] += elapsedNs(start);
+        counts[MIXED] += mixed.size();
+        rotations[MIXED] += TreeOps<Tree>::rotations(*tree) - rot;
+
+        delete tree;
+    }
+
+    for (int i = 0; i < NUM_PHASES; ++i) {
+        BenchResult res;
+        res.tree = treeName;
+        res.dist = DIST_NAMES[dist];
+        res.n = n;
+        res.size = size;
+        res.op = names[i];
+        res.ops = counts[i];
+        res.nsPerOp = counts[i] == 0 ? 0 : totals[i] / counts[i];
+        res.rotationsPerOp = (!TreeOps<Tree>::countsRotations || counts[i] == 0) ? -1 : (double)rotations[i] / counts[i];
+        res.hitRate = -1;
+        results.push_back(res);
+    }
+}
+
+/**
+ * Times building a tree from the distribution's distinct keys in sorted
+ * order (the "bulk" op). Not run for the unbalanced tree, for which sorted
+ * input is always the degenerate case.
+ */
+template<class Tree>
+void runBulk(const string& treeName, Distribution dist, size_t n, uint32_t seed, vector<BenchResult>& results)
+{
+    vector<BenchKey> keys = makeKeys(dist, n, seed);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    vector<pair<const BenchKey, BenchValue> > items;
+    items.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) items.push_back(std::make_pair(keys[i], (BenchValue)i));
+    size_t reps = std::max<size_t>(1, MIN_OPS_PER_SAMPLE / n);
+
+    double total = 0;
+    size_t count = 0;
+    size_t rotations = 0;
+    for (size_t r = 0; r < reps; ++r) {
+        Tree* tree = new Tree;
+        BenchClock::time_point start = BenchClock::now();
+        bulkLoad(*tree, items);
+        total += elapsedNs(start);
+        count += items.size();
+        rotations += TreeOps<Tree>::rotations(*tree);
+        g_sink += TreeOps<Tree>::find(*tree, keys[0]);
+        delete tree;
+    }
+
+    BenchResult res;
+    res.tree = treeName;
+    res.dist = DIST_NAMES[dist];
+    res.n = n;
+    res.size = items.size();
+    res.op = "bulk";
+    res.ops = count;
+    res.nsPerOp = count == 0 ? 0 : total / count;
+    res.rotationsPerOp = (!TreeOps<Tree>::countsRotations || count == 0) ? -1 : (double)rotations / count;
+    res.hitRate = -1;
+    results.push_back(res);
+}
+
+/**
+ * Times find and a full scan on a churned tree, then compacts it into each
+ * node order in turn and times compact() (per node), find and the scan
+ * again. Ops are "find-churned", "iterate-churned" and, for each order,
+ * "compact-<order>", "find-<order>" and "iterate-<order>".
+ */
+template<class Tree>
+void runCompact(const string& treeName, Distribution dist, size_t n, uint32_t seed, vector<BenchResult>& results)
+{
+    vector<BenchKey> keys = makeKeys(dist, n, seed);
+    vector<BenchKey> queries = makeQueries(dist, keys, seed);
+    vector<pair<bool, BenchKey> > mixed = makeMixedOps(keys, seed);
+
+    Tree tree;
+    for (size_t i = 0; i < keys.size(); ++i) TreeOps<Tree>::insert(tree, keys[i], i);
+    for (size_t i = 0; i < mixed.size(); ++i) {
+        if (mixed[i].first) TreeOps<Tree>::insert(tree, mixed[i].second, i);
+        else TreeOps<Tree>::remove(tree, mixed[i].second);
+    }
+    // Look up keys that are still present, so every find runs to a node
+    size_t items = 0;
+    g_sink += TreeOps<Tree>::scan(tree, items);
+    vector<BenchKey> present;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (tree.find(queries[i]) != tree.end()) present.push_back(queries[i]);
+    }
+    size_t reps = std::max<size_t>(1, MIN_OPS_PER_SAMPLE / std::max<size_t>(1, items));
+
+    const char* orderNames[] = { "churned", "bfs", "veb", "inorder" };
+    const typename Tree::NodeOrder orders[] = { Tree::BREADTH_FIRST, Tree::VAN_EMDE_BOAS, Tree::IN_ORDER };
+    for (int o = 0; o < 4; ++o) {
+        string suffix = orderNames[o];
+        if (o > 0) {
+            BenchClock::time_point start = BenchClock::now();
+            tree.compact(orders[o - 1]);
+            BenchResult res = { treeName, DIST_NAMES[dist], n, items, "compact-" + suffix, items, elapsedNs(start) / items, -1, -1, "" };
+            results.push_back(res);
+        }
+
+        BenchClock::time_point start = BenchClock::now();
+        for (size_t r = 0; r < reps; ++r) {
+            for (size_t i = 0; i < present.size(); ++i) g_sink += TreeOps<Tree>::find(tree, present[i]);
+        }
+        size_t count = reps * present.size();
+        BenchResult find = { treeName, DIST_NAMES[dist], n, items, "find-" + suffix, count, count == 0 ? 0 : elapsedNs(start) / count, -1, -1, "" };
+        results.push_back(find);
+
+        size_t visited = 0;
+        start = BenchClock::now();
+        for (size_t r = 0; r < reps; ++r) g_sink += TreeOps<Tree>::scan(tree, visited);
+        BenchResult scan = { treeName, DIST_NAMES[dist], n, items, "iterate-" + suffix, visited, visited == 0 ? 0 : elapsedNs(start) / visited, -1, -1, "" };
+        results.push_back(scan);
+    }
+}
+
+/**
+ * Times find with the lookup cache off ("find-nocache") and with 2^10,
+ * 2^14 and 2^18 slots ("find-cache-<slots>", with the hit rate). Each
+ * cached run starts cold, so the fill cost is included.
+ */
+template<class Tree>
+void runCache(const string& treeName, Distribution dist, size_t n, uint32_t seed, vector<BenchResult>& results)
+{
+    vector<BenchKey> keys = makeKeys(dist, n, seed);
+    vector<BenchKey> queries = makeQueries(dist, keys, seed);
+    Tree tree;
+    for (size_t i = 0; i < keys.size(); ++i) TreeOps<Tree>::insert(tree, keys[i], i);
+    size_t size = 0;
+    g_sink += TreeOps<Tree>::scan(tree, size);
+    size_t reps = std::max<size_t>(1, MIN_OPS_PER_SAMPLE / n);
+
+    const size_t slots[] = { 0, 1 << 10, 1 << 14, 1 << 18 };
+    for (int s = 0; s < 4; ++s) {
+        tree.setLookupCache(slots[s]);
+        tree.resetCacheStats();
+        BenchClock::time_point start = BenchClock::now();
+        for (size_t r = 0; r < reps; ++r) {
+            for (size_t i = 0; i < queries.size(); ++i) g_sink += TreeOps<Tree>::find(tree, queries[i]);
+        }
+        size_t count = reps * queries.size();
+        BenchResult res;
+        res.tree = treeName;
+        res.dist = DIST_NAMES[dist];
+        res.n = n;
+        res.size = size;
+        res.op = slots[s] == 0 ? string("find-nocache") : "find-cache-" + std::to_string(slots[s]);
+        res.ops = count;
+        res.nsPerOp = count == 0 ? 0 : elapsedNs(start) / count;
+        res.rotationsPerOp = -1;
+        size_t lookups = tree.cacheHits() + tree.cacheMisses();
+        res.hitRate = (slots[s] == 0 || lookups == 0) ? -1 : (double)tree.cacheHits() / lookups;
+        results.push_back(res);
+    }
+}
+
+static void recordSkipped(const string& treeName, Distribution dist, size_t n, const string& why, vector<BenchResult>& results)
+{
+    BenchResult res;
+    res.tree = treeName;
+    res.dist = DIST_NAMES[dist];
+    res.n = n;
+    res.size = 0;
+    res.op = "*";
+    res.ops = 0;
+    res.nsPerOp = 0;
+    res.rotationsPerOp = -1;
+    res.hitRate = -1;
+    res.skipped = why;
+    results.push_back(res);
+}
+
+static bool selected(const vector<string>& names, const string& name)
+{
+    return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+}
+
+static vector<string> splitList(const string& s)
+{
+    vector<string> parts;
+    stringstream ss(s);
+    string part;
+    while (std::getline(ss, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+static void writeJson(ostream& os, const BenchConfig& cfg, const vector<BenchResult>& results)
+{
+    os << "{\n";
+    os << "  \"benchmark\": \"bst-bench\",\n";
+    os << "  \"version\": 1,\n";
+    os << "  \"config\": {\"min_size\": " << cfg.minSize << ", \"max_size\": " << cfg.maxSize
+       << ", \"degenerate_cap\": " << cfg.degenerateCap << ", \"seed\": " << cfg.seed << "},\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        os << "    {\"tree\": \"" << r.tree << "\", \"dist\": \"" << r.dist << "\", \"n\": " << r.n
+           << ", \"op\": \"" << r.op << "\"";
+        if (!r.skipped.empty()) {
+            os << ", \"skipped\": \"" << r.skipped << "\"}";
+        } else {
+            os << ", \"size\": " << r.size << ", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.nsPerOp
+               << ", \"mops_per_sec\": " << (r.nsPerOp > 0 ? 1000.0 / r.nsPerOp : 0);
+            if (r.rotationsPerOp >= 0) os << ", \"rotations_per_op\": " << r.rotationsPerOp;
+            if (r.hitRate >= 0) os << ", \"hit_rate\": " << r.hitRate;
+            os << "}";
+        }
+        os << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+static bool parseArgs(int argc, char* argv[], BenchConfig& cfg)
+{
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+        string val = argv[++i];
+        if (arg == "--min-size") cfg.minSize = (size_t)atof(val.c_str());
+        else if (arg == "--max-size") cfg.maxSize = (size_t)atof(val.c_str());
+        else if (arg == "--degenerate-cap") cfg.degenerateCap = (size_t)atof(val.c_str());
+        else if (arg == "--seed") cfg.seed = (uint32_t)strtoul(val.c_str(), NULL, 10);
+        else if (arg == "--trees") cfg.trees = splitList(val);
+        else if (arg == "--dists") cfg.dists = splitList(val);
+        else if (arg == "--out") cfg.out = val;
+        else {
+            cerr << "Unknown option " << arg << endl;
+            return false;
+        }
+    }
+    if (cfg.maxSize > MAX_TREE_SIZE) cfg.maxSize = MAX_TREE_SIZE;
+    if (cfg.minSize < 1) cfg.minSize = 1;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig cfg;
+    cfg.minSize = 1000;
+    cfg.maxSize = 1000000;
+    cfg.degenerateCap = 10000;
+    cfg.seed = 104;
+    if (!parseArgs(argc, argv, cfg)) return 1;
+
+    vector<BenchResult> results;
+    for (size_t n = cfg.minSize; n <= cfg.maxSize; n *= 10) {
+        for (int d = SEQUENTIAL; d <= NEARLY_SORTED; ++d) {
+            Distribution dist = (Distribution)d;
+            if (!selected(cfg.dists, DIST_NAMES[d])) continue;
+            cerr << "n=" << n << " dist=" << DIST_NAMES[d] << endl;
+
+            if (selected(cfg.trees, "bst")) {
+                bool degenerate = (dist != RANDOM && dist != ZIPFIAN);
+                if (degenerate && n > cfg.degenerateCap) {
+                    recordSkipped("bst", dist, n, "degenerate", results);
+                } else {
+                    runOne<BinarySearchTree<BenchKey, BenchValue> >("bst", dist, n, cfg.seed, results, degenerate);
+                }
+            }
+            if (selected(cfg.trees, "avl")) {
+                runOne<AVLTree<BenchKey, BenchValue> >("avl", dist, n, cfg.seed, results);
+                runBulk<AVLTree<BenchKey, BenchValue> >("avl", dist, n, cfg.seed, results);
+                runCompact<AVLTree<BenchKey, BenchValue> >("avl", dist, n, cfg.seed, results);
+                runCache<AVLTree<BenchKey, BenchValue> >("avl", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "wavl")) {
+                runOne<WAVLTree>("wavl", dist, n, cfg.seed, results);
+                runBulk<WAVLTree>("wavl", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "avl-finger")) {
+                runOne<FingerAVLTree>("avl-finger", dist, n, cfg.seed, results);
+                runBulk<FingerAVLTree>("avl-finger", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "rb")) {
+                runOne<RedBlackTree<BenchKey, BenchValue> >("rb", dist, n, cfg.seed, results);
+                runBulk<RedBlackTree<BenchKey, BenchValue> >("rb", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "splay")) {
+                runOne<SplayTree<BenchKey, BenchValue> >("splay", dist, n, cfg.seed, results);
+                runBulk<SplayTree<BenchKey, BenchValue> >("splay", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "treap")) {
+                runOne<Treap<BenchKey, BenchValue> >("treap", dist, n, cfg.seed, results);
+                runBulk<Treap<BenchKey, BenchValue> >("treap", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "art")) {
+                runOne<ArtMap<BenchKey, BenchValue> >("art", dist, n, cfg.seed, results);
+                runBulk<ArtMap<BenchKey, BenchValue> >("art", dist, n, cfg.seed, results);
+            }
+            if (selected(cfg.trees, "map")) {
+                runOne<map<BenchKey, BenchValue> >("map", dist, n, cfg.seed, results);
+                runBulk<map<BenchKey, BenchValue> >("map", dist, n, cfg.seed, results);
+            }
+        }
+    }
+
+    if (cfg.out.empty()) {
+        writeJson(cout, cfg, results);
+    } else {
+        ofstream ofs(cfg.out.c_str());
+        writeJson(ofs, cfg, results);
+    }
+    // Keep g_sink observable so lookups are not optimized away
+    cerr << "checksum " << g_sink << endl;
+    return 0;
+}
@@ -1,10 +1,1671 @@
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "bst.h"
 #include "avlbst.h"
+#include "avlmultimap.h"
+#include "splaybst.h"
+#include "rbbst.h"
+#include "treap.h"
+#include "radixmap.h"
+#include "artmap.h"
+#include "thread-pool.h"
+#include "validate_bst.h"
+#include "stats_bst.h"
 
 using namespace std;
 
+// Failed checks so far; main returns nonzero if there were any
+int failures = 0;
+
+void report(const char* name, bool ok)
+{
+    cout << name << ": " << (ok ? "ok" : "FAILED") << endl;
+    if(!ok) {
+        failures++;
+    }
+}
+
+// Background clear: the tree is empty right away and the pool frees the
+// nodes, including ones compact() moved into its block
+bool clearInBackgroundTest()
+{
+    ThreadPool pool(2);
+    AVLTree<int,int> big;
+    big.setLookupCache(64);
+    for(int i = 0; i < 1000; i++) {
+        big.insert(std::make_pair(i, i));
+    }
+    big.compact();
+    big.insert(std::make_pair(1000, 1000));
+    bool ok = big.find(3) != big.end();
+    big.clearInBackground(pool);
+    ok = ok && big.empty() && big.find(3) == big.end();
+    big.insert(std::make_pair(7, 7));
+    pool.wait();
+    return ok && big.find(7) != big.end() && big[7] == 7 && big.find(3) == big.end();
+}
+
+// Minimal JSON parser for checking exporter output: accepts exactly the
+// JSON grammar and collects every decoded string
+struct JsonChecker
+{
+    std::string text;
+    size_t pos;
+    std::vector<std::string> strings;
+
+    explicit JsonChecker(const std::string& t) : text(t), pos(0) {}
+
+    void skipSpace()
+    {
+        while(pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\t' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+    bool literal(const char* word)
+    {
+        size_t n = strlen(word);
+        if(text.compare(pos, n, word) != 0) {
+            return false;
+        }
+        pos += n;
+        return true;
+    }
+    bool string()
+    {
+        std::string decoded;
+        pos++;
+        while(pos < text.size() && text[pos] != '"') {
+            unsigned char c = text[pos++];
+            if(c < 0x20) {
+                return false;
+            }
+            if(c != '\\') {
+                decoded += c;
+                continue;
+            }
+            if(pos >= text.size()) {
+                return false;
+            }
+            char e = text[pos++];
+            const char* simple = strchr("\"\\/bfnrt", e);
+            if(e != 0 && simple != NULL) {
+                decoded += "\"\\/\b\f\n\r\t"[simple - "\"\\/bfnrt"];
+            }
+            else if(e == 'u' && pos + 4 <= text.size()) {
+                unsigned code = strtoul(text.substr(pos, 4).c_str(), NULL, 16);
+                if(text.substr(pos, 4).find_first_not_of("0123456789abcdefABCDEF") != std::string::npos || code > 0x7f) {
+                    return false;
+                }
+                decoded += static_cast<char>(code);
+                pos += 4;
+            }
+            else {
+                return false;
+            }
+        }
+        if(pos >= text.size()) {
+            return false;
+        }
+        pos++;
+        strings.push_back(decoded);
+        return true;
+    }
+    bool number()
+    {
+        size_t start = pos;
+        if(text[pos] == '-') {
+            pos++;
+        }
+        size_t digits = pos;
+        while(pos < text.size() && (isdigit(text[pos]) || text[pos] == '.' || text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' || text[pos] == '-')) {
+            pos++;
+        }
+        char* end = NULL;
+        strtod(text.c_str() + start, &end);
+        return pos > digits && isdigit(text[digits]) && end == text.c_str() + pos;
+    }
+    bool value()
+    {
+        skipSpace();
+        if(pos >= text.size()) {
+            return false;
+        }
+        char c = text[pos];
+        if(c == '{' || c == '[') {
+            char close = (c == '{') ? '}' : ']';
+            pos++;
+            skipSpace();
+            if(pos < text.size() && text[pos] == close) {
+                pos++;
+                return true;
+            }
+            while(true) {
+                if(c == '{') {
+                    skipSpace();
+                    if(pos >= text.size() || text[pos] != '"' || !string()) {
+                        return false;
+                    }
+                    skipSpace();
+                    if(pos >= text.size() || text[pos++] != ':') {
+                        return false;
+                    }
+                }
+                if(!value()) {
+                    return false;
+                }
+                skipSpace();
+                if(pos >= text.size()) {
+                    return false;
+                }
+                if(text[pos] == close) {
+                    pos++;
+                    return true;
+                }
+                if(text[pos++] != ',') {
+                    return false;
+                }
+            }
+        }
+        if(c == '"') {
+            return string();
+        }
+        if(c == '-' || isdigit(c)) {
+            return number();
+        }
+        return literal("true") || literal("false") || literal("null");
+    }
+    bool document()
+    {
+        bool ok = value();
+        skipSpace();
+        return ok && pos == text.size();
+    }
+};
+
+// Counts the occurrences of needle in text
+size_t countOf(const std::string& text, const std::string& needle)
+{
+    size_t count = 0;
+    for(size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+// DOT output: one statement per line, every quote balanced and no raw
+// control bytes; returns the number of node and edge statements
+bool dotWellFormed(const std::string& dot, size_t& nodes, size_t& edges)
+{
+    nodes = 0;
+    edges = 0;
+    if(dot.compare(0, 14, "digraph BST {\n") != 0 || dot.size() < 2 || dot.compare(dot.size() - 2, 2, "}\n") != 0) {
+        return false;
+    }
+    std::istringstream lines(dot);
+    std::string line;
+    while(std::getline(lines, line)) {
+        bool quoted = false;
+        for(size_t i = 0; i < line.size(); i++) {
+            if(static_cast<unsigned char>(line[i]) < 0x20 && line[i] != '\t') {
+                return false;
+            }
+            if(quoted && line[i] == '\\') {
+                i++;
+            }
+            else if(line[i] == '"') {
+                quoted = !quoted;
+            }
+        }
+        if(quoted) {
+            return false;
+        }
+        if(line.find(" -> ") != std::string::npos) {
+            edges++;
+        }
+        else if(line.find("[label=") != std::string::npos) {
+            nodes++;
+        }
+    }
+    return true;
+}
+
+// exportJson/exportDot: well-formed output, truncation by depth and node
+// count, subtree export and escaping of awkward keys
+bool exportTest()
+{
+    AVLTree<int,int> at;
+    for(int i = 0; i < 31; i++) {
+        at.insert(std::make_pair(i, i * 10));
+    }
+    bool ok = true;
+    size_t nodes = 0;
+    size_t edges = 0;
+
+    std::ostringstream json;
+    at.exportJson(json);
+    JsonChecker full(json.str());
+    ok = ok && full.document() && countOf(json.str(), "{\"id\"") == 31 && countOf(json.str(), "\"truncated\": false") == 1;
+
+    std::ostringstream dot;
+    at.exportDot(dot);
+    ok = ok && dotWellFormed(dot.str(), nodes, edges) && nodes == 31 && edges == 30;
+
+    // Sequential inserts of 2^5 - 1 keys give a perfect tree, so two
+    // levels hold three nodes
+    std::ostringstream shallow;
+    at.exportJson(shallow, 2);
+    JsonChecker shallowChecker(shallow.str());
+    ok = ok && shallowChecker.document() && countOf(shallow.str(), "{\"id\"") == 3 && countOf(shallow.str(), "\"truncated\": true") == 1;
+
+    std::ostringstream few;
+    at.exportJson(few, 0, 5);
+    JsonChecker fewChecker(few.str());
+    ok = ok && fewChecker.document() && countOf(few.str(), "{\"id\"") == 5 && countOf(few.str(), "\"truncated\": true") == 1;
+
+    std::ostringstream fewDot;
+    at.exportDot(fewDot, 3, 0);
+    ok = ok && dotWellFormed(fewDot.str(), nodes, edges) && nodes == 7 && edges == 6 && countOf(fewDot.str(), "truncated") == 1;
+
+    // The subtree under the root's left child holds keys 0..14; its root
+    // has no parent in the export
+    std::ostringstream sub;
+    at.exportSubtreeJson(sub, 7);
+    JsonChecker subChecker(sub.str());
+    ok = ok && subChecker.document() && countOf(sub.str(), "{\"id\"") == 15 && countOf(sub.str(), "\"parent\": null") == 1;
+    ok = ok && countOf(sub.str(), "\"key\": 15,") == 0 && countOf(sub.str(), "\"key\": 14,") == 1;
+    std::ostringstream subDot;
+    at.exportSubtreeDot(subDot, 7, 0, 4);
+    ok = ok && dotWellFormed(subDot.str(), nodes, edges) && nodes == 4 && edges == 3;
+
+    // Keys with quotes, backslashes and control bytes decode back intact
+    BinarySearchTree<std::string,std::string> st;
+    const char* awkward[] = { "plain", "quote\"d", "back\\slash", "new\nline", "tab\tbell\a", "\x01\x1f\x7f" };
+    for(int i = 0; i < 6; i++) {
+        st.insert(std::make_pair(std::string(awkward[i]), std::string(awkward[5 - i])));
+    }
+    std::ostringstream sjson;
+    st.exportJson(sjson);
+    JsonChecker strings(sjson.str());
+    ok = ok && strings.document();
+    for(int i = 0; i < 6; i++) {
+        ok = ok && std::count(strings.strings.begin(), strings.strings.end(), std::string(awkward[i])) == 2;
+    }
+    std::ostringstream sdot;
+    st.exportDot(sdot);
+    ok = ok && dotWellFormed(sdot.str(), nodes, edges) && nodes == 6 && edges == 5;
+
+    // Single-byte numbers and non-finite doubles still make valid JSON
+    BinarySearchTree<uint8_t,double> numbers;
+    numbers.insert(std::make_pair(200, std::numeric_limits<double>::quiet_NaN()));
+    numbers.insert(std::make_pair(7, -std::numeric_limits<double>::infinity()));
+    numbers.insert(std::make_pair(250, 0.5));
+    std::ostringstream njson;
+    numbers.exportJson(njson);
+    JsonChecker numberChecker(njson.str());
+    ok = ok && numberChecker.document() && countOf(njson.str(), "\"key\": 200, \"value\": null") == 1;
+    return ok && countOf(njson.str(), "\"key\": 7, \"value\": null") == 1;
+}
+
+// Builds a plain BST by inserting keys in the given order
+BinarySearchTree<int,int>* shapeFrom(const int* keys, int count)
+{
+    BinarySearchTree<int,int>* tree = new BinarySearchTree<int,int>;
+    for(int i = 0; i < count; i++) {
+        tree->insert(std::make_pair(keys[i], keys[i]));
+    }
+    return tree;
+}
+
+bool sameHistogram(const ShapeStats& stats, const size_t* expected, size_t count)
+{
+    return stats.leafDepthHistogram == std::vector<size_t>(expected, expected + count);
+}
+
+// ShapeAnalyzer on trees of known shape (depths count edges from the root)
+bool shapeTest()
+{
+    typedef ShapeAnalyzer<int,int> Analyzer;
+    bool ok = true;
+
+    // Perfect tree of four levels: 8 leaves at depth 3
+    const int perfectKeys[] = { 8, 4, 12, 2, 6, 10, 14, 1, 3, 5, 7, 9, 11, 13, 15 };
+    BinarySearchTree<int,int>* perfect = shapeFrom(perfectKeys, 15);
+    ShapeStats stats = Analyzer::analyze(*perfect);
+    const size_t perfectHistogram[] = { 0, 0, 0, 8 };
+    ok = ok && stats.nodes == 15 && stats.leaves == 8 && stats.deadNodes == 0;
+    ok = ok && stats.minLeafDepth == 3 && stats.maxLeafDepth == 3 && stats.equalLeafPaths;
+    ok = ok && sameHistogram(stats, perfectHistogram, 4);
+    ok = ok && std::fabs(stats.averageSearchDepth - (34.0 / 15 + 1)) < 1e-9;
+    delete perfect;
+
+    // Left chain of five nodes: one leaf, depths 0..4
+    const int chainKeys[] = { 5, 4, 3, 2, 1 };
+    BinarySearchTree<int,int>* chain = shapeFrom(chainKeys, 5);
+    stats = Analyzer::analyze(*chain);
+    const size_t chainHistogram[] = { 0, 0, 0, 0, 1 };
+    ok = ok && stats.nodes == 5 && stats.leaves == 1 && stats.minLeafDepth == 4 && stats.maxLeafDepth == 4;
+    ok = ok && stats.equalLeafPaths && sameHistogram(stats, chainHistogram, 5) && stats.averageSearchDepth == 3;
+    delete chain;
+
+    // One-child nodes on both sides: leaves 1 (depth 3) and 20 (depth 2)
+    const int lopsidedKeys[] = { 10, 5, 15, 3, 20, 1 };
+    BinarySearchTree<int,int>* lopsided = shapeFrom(lopsidedKeys, 6);
+    stats = Analyzer::analyze(*lopsided);
+    const size_t lopsidedHistogram[] = { 0, 0, 1, 1 };
+    ok = ok && stats.nodes == 6 && stats.leaves == 2 && stats.minLeafDepth == 2 && stats.maxLeafDepth == 3;
+    ok = ok && !stats.equalLeafPaths && sameHistogram(stats, lopsidedHistogram, 4) && stats.averageSearchDepth == 2.5;
+    delete lopsided;
+
+    BinarySearchTree<int,int> empty;
+    stats = Analyzer::analyze(empty);
+    ok = ok && stats.nodes == 0 && stats.minLeafDepth == -1 && stats.maxLeafDepth == -1;
+    ok = ok && stats.equalLeafPaths && stats.leafDepthHistogram.empty() && stats.averageSearchDepth == 0;
+
+    // Tombstones stay linked, so they count as nodes and as dead nodes
+    AVLTree<int,int> buried;
+    buried.setTombstones(0.9);
+    for(int i = 0; i < 100; i++) {
+        buried.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 100; i += 10) {
+        buried.remove(i);
+    }
+    stats = ShapeAnalyzer<int,int>::analyze(buried);
+    ok = ok && stats.nodes == 100 && stats.deadNodes == 10 && buried.tombstoneCount() == 10;
+    ok = ok && stats.maxLeafDepth + 1 == buried.height();
+    return ok;
+}
+
+// Multimap: duplicates are all kept, counted and returned oldest first
+bool multimapTest()
+{
+    AVLMultiMap<int,int> mm;
+    bool ok = true;
+    for(int i = 0; i < 30; i++) {
+        mm.insert(std::make_pair(i % 3, i));
+    }
+    ok = ok && mm.size() == 30 && mm.count(1) == 10 && mm.count(7) == 0;
+    ok = ok && mm.find(2)->second == 2 && mm[2] == 2;
+
+    // equal_range visits one key's items in insertion order
+    std::pair<AVLMultiMap<int,int>::iterator, AVLMultiMap<int,int>::iterator> range = mm.equal_range(1);
+    int expected = 1;
+    for(AVLMultiMap<int,int>::iterator it = range.first; it != range.second; ++it) {
+        ok = ok && it->first == 1 && it->second == expected;
+        expected += 3;
+    }
+    ok = ok && expected == 31;
+
+    // Erasing the oldest makes the next one the oldest
+    mm.erase(mm.find(1));
+    ok = ok && mm.count(1) == 9 && mm[1] == 4 && mm.countRange(0, 2) == 19;
+    mm.remove(0);
+    ok = ok && mm.count(0) == 0 && mm.size() == 19 && mm.find(0) == mm.end();
+    return ok;
+}
+
+
+// Collects the keys of a tree in iteration order
+template<typename Tree>
+std::vector<int> keysOf(const Tree& tree)
+{
+    std::vector<int> keys;
+    for(auto it = tree.begin(); it != tree.end(); ++it) {
+        keys.push_back(it->first);
+    }
+    return keys;
+}
+
+// Tombstones: removed keys stay linked but are skipped everywhere, and
+// the tree rebuilds once too many of them pile up
+bool tombstoneTest()
+{
+    AVLTree<int,int> at;
+    at.setTombstones(0.5);
+    bool ok = true;
+    for(int i = 0; i < 100; i++) {
+        at.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 100; i += 2) {
+        at.remove(i);
+    }
+    ok = ok && at.tombstoneCount() == 50 && at.find(10) == at.end() && at.find(11) != at.end();
+    std::vector<int> keys = keysOf(at);
+    ok = ok && keys.size() == 50 && keys.front() == 1 && keys.back() == 99;
+    ok = ok && at.begin()->first == 1 && at.countRange(0, 10) == 5;
+
+    // Reinserting a buried key brings it back with the new value
+    at.insert(std::make_pair(10, -10));
+    ok = ok && at.find(10) != at.end() && at[10] == -10;
+
+    // One more dead node tips it over half, so the tree rebuilds
+    at.remove(1);
+    at.remove(3);
+    ok = ok && at.tombstoneCount() == 0 && keysOf(at).size() == 49 && at.isBalanced();
+
+    TreeValidator<int,int> validator(at);
+    ok = ok && validator.step(1000);
+
+    // Purging in steps and turning the mode off both drop the rest
+    at.remove(5);
+    at.remove(7);
+    ok = ok && at.purgeTombstones(1) == 1;
+    at.remove(9);
+    at.setTombstones(0);
+    ok = ok && at.tombstoneCount() == 0 && keysOf(at).size() == 46 && validator.step(1000);
+    return ok;
+}
+
+// Erases [lo, hi) from tree and from the reference map, comparing the
+// counts on both sides and the contents afterwards
+template<typename Tree>
+bool eraseRangeMatches(Tree& tree, std::map<int,int>& ref, int lo, int hi)
+{
+    size_t expected = 0;
+    if(lo < hi) {
+        expected = std::distance(ref.lower_bound(lo), ref.lower_bound(hi));
+    }
+    bool ok = tree.countRange(lo, hi) == expected;
+    ok = ok && tree.eraseRange(lo, hi) == expected;
+    if(lo < hi) {
+        ref.erase(ref.lower_bound(lo), ref.lower_bound(hi));
+    }
+    std::vector<int> keys = keysOf(tree);
+    ok = ok && keys.size() == ref.size() && std::equal(keys.begin(), keys.end(), keysOf(ref).begin());
+    return ok;
+}
+
+// Range erase and count on [lo, hi): hi itself stays, and empty or
+// reversed ranges erase nothing
+template<typename Tree>
+bool eraseRangeTest(Tree& tree)
+{
+    std::map<int,int> ref;
+    for(int i = 0; i < 500; i += 2) {
+        tree.insert(std::make_pair(i, i));
+        ref[i] = i;
+    }
+    bool ok = eraseRangeMatches(tree, ref, 10, 20);
+    ok = ok && tree.find(20) != tree.end() && tree.find(18) == tree.end();
+    ok = ok && eraseRangeMatches(tree, ref, 30, 30);
+    ok = ok && eraseRangeMatches(tree, ref, 50, 40);
+    ok = ok && eraseRangeMatches(tree, ref, -100, 3);
+    ok = ok && eraseRangeMatches(tree, ref, 480, 1000);
+    srand(47);
+    for(int i = 0; i < 50 && ok; i++) {
+        int lo = rand() % 520 - 10;
+        ok = eraseRangeMatches(tree, ref, lo, lo + rand() % 40);
+        int k = rand() % 500;
+        tree.insert(std::make_pair(k, k));
+        ref[k] = k;
+    }
+    TreeValidator<int,int> validator(tree);
+    ok = ok && validator.step(1000);
+    return ok && eraseRangeMatches(tree, ref, -1, 1000) && tree.empty();
+}
+
+// compact() in each order, then inserts, removes, range erases and a
+// second compact on top of the block, checked against std::map
+bool compactTest()
+{
+    const AVLTree<int,int>::NodeOrder orders[] = {
+        AVLTree<int,int>::BREADTH_FIRST, AVLTree<int,int>::VAN_EMDE_BOAS, AVLTree<int,int>::IN_ORDER
+    };
+    bool ok = true;
+    srand(49);
+    for(int o = 0; o < 3; o++) {
+        AVLTree<int,int> at(o == 1);
+        std::map<int,int> ref;
+        for(int i = 0; i < 2000; i++) {
+            int k = rand() % 4000;
+            at.insert(std::make_pair(k, i));
+            ref[k] = i;
+        }
+        at.compact(orders[o]);
+        ok = ok && keysOf(at) == keysOf(ref);
+        for(int round = 0; round < 2; round++) {
+            for(int i = 0; i < 1000; i++) {
+                int k = rand() % 4000;
+                if(i % 2 == 0) {
+                    at.insert(std::make_pair(k, -i));
+                    ref[k] = -i;
+                }
+                else {
+                    at.remove(k);
+                    ref.erase(k);
+                }
+            }
+            at.eraseRange(100, 300);
+            ref.erase(ref.lower_bound(100), ref.lower_bound(300));
+            // The validator checks AVL balances or, in WAVL mode, ranks
+            TreeValidator<int,int> validator(at);
+            ok = ok && keysOf(at) == keysOf(ref) && validator.step(10000);
+            ok = ok && at.find(ref.begin()->first)->second == ref.begin()->second;
+            at.compact(orders[(o + round + 1) % 3]);
+        }
+        TreeValidator<int,int> validator(at);
+        ok = ok && validator.step(10000) && keysOf(at) == keysOf(ref);
+
+        // Moving a compacted tree hands over the block too
+        AVLTree<int,int> moved(std::move(at));
+        moved.insert(std::make_pair(5000, 1));
+        moved.remove(ref.rbegin()->first);
+        ok = ok && at.empty() && moved.find(5000) != moved.end();
+    }
+
+    // The multimap relocates its own node type
+    AVLMultiMap<int,int> mm;
+    for(int i = 0; i < 300; i++) {
+        mm.insert(std::make_pair(i % 50, i));
+    }
+    mm.compact();
+    for(int i = 0; i < 100; i++) {
+        mm.insert(std::make_pair(i % 7, i));
+    }
+    mm.remove(3);
+    ok = ok && mm.size() == 300 + 100 - 6 - 14 && mm.count(6) == 6 + 14 && mm[6] == 6;
+    TreeValidator<int,int> multiValidator(mm);
+    return ok && multiValidator.step(10000);
+}
+
+// Looks every reference key up in tree (filling its lookup cache) and
+// checks the value, plus a few keys that must be missing
+template<typename Tree>
+bool findsMatch(const Tree& tree, const std::map<int,int>& ref)
+{
+    for(std::map<int,int>::const_iterator it = ref.begin(); it != ref.end(); ++it) {
+        typename Tree::iterator found = tree.find(it->first);
+        if(found == tree.end() || found->second != it->second || tree[it->first] != it->second) {
+            return false;
+        }
+    }
+    for(int k = -5; k < 0; k++) {
+        if(tree.find(k) != tree.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lookup cache: removes (including two-child removes, which nodeSwap the
+// successor into place), clear, rebuilds and compact must never leave a
+// slot pointing at a freed or moved node
+template<typename Tree>
+bool cacheTest(Tree& tree)
+{
+    std::map<int,int> ref;
+    tree.setLookupCache(64);
+    bool ok = true;
+    srand(50);
+    for(int i = 0; i < 400; i++) {
+        int k = rand() % 200;
+        tree.insert(std::make_pair(k, i));
+        ref[k] = i;
+    }
+    ok = ok && findsMatch(tree, ref);
+    for(int i = 0; i < 300 && ok; i++) {
+        int k = rand() % 200;
+        if(i % 3 == 0) {
+            tree.insert(std::make_pair(k, -i));
+            ref[k] = -i;
+        }
+        else {
+            tree.remove(k);
+            ref.erase(k);
+        }
+        ok = findsMatch(tree, ref);
+    }
+    tree.clear();
+    ref.clear();
+    ok = ok && findsMatch(tree, ref) && tree.find(1) == tree.end();
+    tree.insert(std::make_pair(1, 100));
+    ref[1] = 100;
+    return ok && findsMatch(tree, ref) && tree.cacheHits() > 0;
+}
+
+// find, lower_bound and remove with probes of a type other than Key, on
+// cached trees: const char* on std::string keys goes straight to the
+// tree, integral probes that round-trip through int use the cache, and
+// ones that don't (out of range, or not integral) must not.
+template<typename StringTree, typename IntTree>
+bool heterogeneousTest(StringTree& words, IntTree& numbers)
+{
+    const char* list[] = { "apple", "banana", "cherry", "date", "elder", "fig" };
+    words.setLookupCache(16);
+    for(int i = 0; i < 6; i++) {
+        words.insert(std::make_pair(std::string(list[i]), i));
+    }
+    bool ok = words.find("cherry") != words.end() && words.find("cherry")->second == 2;
+    ok = ok && words.find("cherr") == words.end() && words.find("zebra") == words.end();
+    ok = ok && words.lower_bound("c")->first == "cherry" && words.lower_bound("dog")->first == "elder";
+    ok = ok && words.lower_bound("fig")->first == "fig" && words.lower_bound("figs") == words.end();
+    // Cache the node, then remove it through a const char* probe
+    ok = ok && words.find(std::string("date")) != words.end() && words.find(std::string("date")) != words.end();
+    words.remove("date");
+    words.remove("dates");
+    ok = ok && words.find(std::string("date")) == words.end() && words.find("date") == words.end();
+    ok = ok && words.countRange("", "z") == 5 && words.cacheHits() > 0;
+
+    numbers.setLookupCache(64);
+    for(int i = -100; i <= 100; i += 2) {
+        numbers.insert(std::make_pair(i, i * 10));
+    }
+    numbers.resetCacheStats();
+    // long long and short probes that fit in int go through the cache
+    ok = ok && numbers.find(-4LL)->second == -40 && numbers.find(-4LL)->second == -40;
+    ok = ok && numbers.find(static_cast<short>(8))->second == 80 && numbers.find(8)->second == 80;
+    ok = ok && numbers.cacheHits() >= 2;
+    // 2^32 truncates to 0 as an int; it must not find key 0
+    numbers.find(0);
+    size_t hits = numbers.cacheHits(), misses = numbers.cacheMisses();
+    ok = ok && numbers.find(1LL << 32) == numbers.end() && numbers.find(-(1LL << 32)) == numbers.end();
+    ok = ok && numbers.cacheHits() == hits && numbers.cacheMisses() == misses;
+    // Non-integral probes compare as themselves
+    ok = ok && numbers.find(4.0)->first == 4 && numbers.find(4.5) == numbers.end();
+    ok = ok && numbers.lower_bound(4.5)->first == 6 && numbers.lower_bound(-1000LL)->first == -100;
+    ok = ok && numbers.lower_bound(101LL) == numbers.end();
+    // Removing through a wider type forgets the cached node
+    ok = ok && numbers.find(6) != numbers.end();
+    numbers.remove(6LL);
+    numbers.remove(7LL);
+    numbers.remove(1LL << 32);
+    ok = ok && numbers.find(6) == numbers.end() && numbers.find(6LL) == numbers.end() && numbers.find(0) != numbers.end();
+    TreeValidator<int,int> validator(numbers);
+    return ok && keysOf(numbers).size() == 100 && validator.step(100000);
+}
+
+// AVL-only paths that free or move nodes: tombstone rebuilds and compact()
+bool avlCacheTest()
+{
+    AVLTree<int,int> at;
+    std::map<int,int> ref;
+    at.setLookupCache(64);
+    at.setTombstones(0.25);
+    for(int i = 0; i < 200; i++) {
+        at.insert(std::make_pair(i, i));
+        ref[i] = i;
+    }
+    bool ok = findsMatch(at, ref);
+    for(int i = 0; i < 200 && ok; i += 3) {
+        at.remove(i);
+        ref.erase(i);
+        ok = findsMatch(at, ref);
+    }
+    at.compact();
+    ok = ok && findsMatch(at, ref);
+    at.eraseRange(50, 150);
+    ref.erase(ref.lower_bound(50), ref.lower_bound(150));
+    at.compact(AVLTree<int,int>::IN_ORDER);
+    return ok && findsMatch(at, ref);
+}
+
+// Randomized differential test: a stream of inserts (some overwriting),
+// removes (some of missing keys) and lookups on tree and ref, a std::map
+// with the tree's comparator, with the full contents compared every so
+// often and at the end. makeKey maps 0..999 to the tree's keys.
+template<typename Tree, typename Ref, typename MakeKey>
+bool keyedDifferentialTest(Tree& tree, Ref& ref, MakeKey makeKey, unsigned seed)
+{
+    typedef typename Ref::key_type Key;
+    srand(seed);
+    const int KEYS = 1000;
+    for(int i = 0; i < 20000; i++) {
+        int op = rand() % 20;
+        Key k = makeKey(rand() % KEYS);
+        if(op < 9) {
+            tree.insert(std::make_pair(k, i));
+            ref[k] = i;
+        }
+        else if(op < 15) {
+            tree.remove(k);
+            ref.erase(k);
+        }
+        else {
+            typename Tree::iterator found = tree.find(k);
+            typename Ref::iterator expected = ref.find(k);
+            if((found == tree.end()) != (expected == ref.end())) {
+                return false;
+            }
+            if(expected != ref.end() && found->second != expected->second) {
+                return false;
+            }
+        }
+        if(i % 997 == 0 || i == 19999) {
+            std::vector<std::pair<Key,int> > items;
+            for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+                items.push_back(std::make_pair(it->first, it->second));
+            }
+            std::vector<std::pair<Key,int> > expected(ref.begin(), ref.end());
+            if(items != expected || tree.empty() != ref.empty()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int identityKey(int k)
+{
+    return k;
+}
+
+template<typename Tree>
+bool differentialTest(Tree& tree, unsigned seed)
+{
+    std::map<int,int> ref;
+    return keyedDifferentialTest(tree, ref, identityKey, seed);
+}
+
+// Unpadded, so string order differs from numeric order ("key10" < "key9")
+std::string wordKey(int k)
+{
+    return "key" + std::to_string(k);
+}
+
+// Differential runs through the non-default compare() specializations:
+// std::greater<int> iterates in descending order, std::string keys use
+// the string three-way compare
+template<typename Tree, typename Ref, typename MakeKey>
+bool comparatorDifferentialTest(Tree& tree, Ref& ref, MakeKey makeKey, unsigned seed)
+{
+    bool ok = keyedDifferentialTest(tree, ref, makeKey, seed);
+    TreeValidator<typename Ref::key_type, int, typename Ref::key_compare> validator(tree);
+    return ok && validator.step(100000);
+}
+
+// differentialTest plus a full invariant sweep, for the BinarySearchTree family
+template<typename Tree>
+bool checkedDifferentialTest(Tree& tree, unsigned seed)
+{
+    bool ok = differentialTest(tree, seed);
+    TreeValidator<int,int> validator(tree);
+    return ok && validator.step(100000);
+}
+
+// Treap split, merge and unionWith against std::map, with the lookup
+// cache on since those hand nodes from one treap to another
+bool treapSplitMergeTest()
+{
+    Treap<int,int> left(1);
+    Treap<int,int> right(2);
+    std::map<int,int> ref;
+    left.setLookupCache(64);
+    right.setLookupCache(64);
+    srand(33);
+    for(int i = 0; i < 500; i++) {
+        int k = rand() % 1000;
+        left.insert(std::make_pair(k, i));
+        ref[k] = i;
+    }
+    bool ok = findsMatch(left, ref);
+
+    left.split(400, right);
+    std::map<int,int> refRight(ref.lower_bound(400), ref.end());
+    ref.erase(ref.lower_bound(400), ref.end());
+    ok = ok && findsMatch(left, ref) && findsMatch(right, refRight);
+
+    left.merge(right);
+    ref.insert(refRight.begin(), refRight.end());
+    ok = ok && right.empty() && findsMatch(left, ref) && findsMatch(right, std::map<int,int>());
+
+    // Overlapping keys take other's value
+    Treap<int,int> other(3);
+    other.setLookupCache(64);
+    for(int i = 0; i < 300; i++) {
+        int k = rand() % 1500;
+        other.insert(std::make_pair(k, -i));
+        ref[k] = -i;
+    }
+    left.unionWith(other);
+    ok = ok && other.empty() && findsMatch(left, ref);
+
+    left.eraseRange(100, 900);
+    ref.erase(ref.lower_bound(100), ref.lower_bound(900));
+    TreeValidator<int,int> validator(left);
+    return ok && findsMatch(left, ref) && keysOf(left) == keysOf(ref) && validator.step(10000);
+}
+
+// RadixMap against std::map on short keys over a small alphabet, so keys
+// share prefixes and are prefixes of each other (including "")
+bool radixDifferentialTest()
+{
+    RadixMap<int> radix;
+    std::map<std::string,int> ref;
+    srand(36);
+    for(int i = 0; i < 20000; i++) {
+        std::string k(rand() % 6, 'a');
+        for(size_t j = 0; j < k.size(); j++) {
+            k[j] = "abc"[rand() % 3];
+        }
+        int op = rand() % 20;
+        if(op < 9) {
+            radix.insert(std::make_pair(k, i));
+            ref[k] = i;
+        }
+        else if(op < 15) {
+            radix.remove(k);
+            ref.erase(k);
+        }
+        else {
+            RadixMap<int>::iterator found = radix.find(k);
+            std::map<std::string,int>::iterator expected = ref.find(k);
+            if((found == radix.end()) != (expected == ref.end())) {
+                return false;
+            }
+            if(expected != ref.end() && (found->second != expected->second || radix[k] != expected->second)) {
+                return false;
+            }
+        }
+        if(i % 997 == 0 || i == 19999) {
+            std::vector<std::pair<std::string,int> > items;
+            for(RadixMap<int>::iterator it = radix.begin(); it != radix.end(); ++it) {
+                items.push_back(std::make_pair(it->first, it->second));
+            }
+            std::vector<std::pair<std::string,int> > expected(ref.begin(), ref.end());
+            if(items != expected || radix.empty() != ref.empty()) {
+                return false;
+            }
+        }
+    }
+
+    // Moves hand the whole tree over
+    RadixMap<int> moved(std::move(radix));
+    return radix.empty() && moved.empty() == ref.empty() && (ref.empty() || moved.find(ref.begin()->first) != moved.end());
+}
+
+// Exposes the node that holds a key
+class RadixPeek : public RadixMap<int>
+{
+public:
+    const RadixNode<int>* nodeOf(const std::string& key) const
+    {
+        return findNode(key.data(), key.size());
+    }
+};
+
+// Bytes of key text stored in the nodes on the paths to keys, counting
+// each shared node once
+size_t storedPrefixBytes(const RadixPeek& radix, const std::vector<std::string>& keys)
+{
+    std::set<const RadixNode<int>*> seen;
+    size_t bytes = 0;
+    for(size_t i = 0; i < keys.size(); i++) {
+        for(const RadixNode<int>* n = radix.nodeOf(keys[i]); n != NULL && seen.insert(n).second; n = n->getParent()) {
+            bytes += n->getPrefix().size();
+        }
+    }
+    return bytes;
+}
+
+// Keys with long shared prefixes are stored once per branch point: a key
+// node holds only its distinct suffix, edges split on insert and merge
+// back on remove
+bool radixCompressionTest()
+{
+    RadixPeek radix;
+    const std::string base = "https://example.com/api/v1/users/";
+    radix.insert(std::make_pair(base + "alice", 1));
+    const RadixNode<int>* alice = radix.nodeOf(base + "alice");
+    bool ok = alice != NULL && alice->getPrefix() == base + "alice" && alice->getParent()->getParent() == NULL;
+
+    // A second key splits the edge at the first differing byte
+    radix.insert(std::make_pair(base + "albert", 2));
+    alice = radix.nodeOf(base + "alice");
+    const RadixNode<int>* albert = radix.nodeOf(base + "albert");
+    ok = ok && alice->getPrefix() == "ice" && albert->getPrefix() == "bert" && alice->getParent() == albert->getParent();
+    ok = ok && alice->getParent()->getPrefix() == base + "al" && !alice->getParent()->hasValue();
+
+    // Removing one merges the pass-through node back into the other
+    radix.remove(base + "albert");
+    alice = radix.nodeOf(base + "alice");
+    ok = ok && alice->getPrefix() == base + "alice" && alice->getParent()->getParent() == NULL;
+    radix.remove(base + "alice");
+    ok = ok && radix.empty();
+
+    std::vector<std::string> keys;
+    size_t keyBytes = 0;
+    for(int i = 0; i < 1000; i++) {
+        keys.push_back(base + std::to_string(i * 7919 % 100000) + (i % 3 == 0 ? "/profile" : ""));
+        keyBytes += keys.back().size();
+        radix.insert(std::make_pair(keys.back(), i));
+    }
+    size_t full = storedPrefixBytes(radix, keys);
+    ok = ok && full < keyBytes / 5;
+
+    // Removing every other key leaves the rest as compressed as before
+    std::vector<std::string> kept;
+    for(size_t i = 0; i < keys.size(); i++) {
+        if(i % 2 == 0) {
+            radix.remove(keys[i]);
+        }
+        else {
+            kept.push_back(keys[i]);
+        }
+    }
+    size_t half = storedPrefixBytes(radix, kept);
+    for(size_t i = 0; i < kept.size() && ok; i++) {
+        ok = radix.find(kept[i]) != radix.end();
+    }
+    return ok && half < full && half < keyBytes / 10;
+}
+
+// Exposes the layout of an ArtMap's root
+class ArtPeek : public ArtMap<uint32_t,int>
+{
+public:
+    // -1 for a leaf or an empty map, else the inner node type
+    int rootType() const
+    {
+        return (root_ == NULL || isLeaf(root_)) ? -1 : static_cast<Inner*>(root_)->type;
+    }
+    int rootPrefixLength() const
+    {
+        return static_cast<Inner*>(root_)->prefixLen;
+    }
+};
+
+// Expected root layout for count children under one inner node: growing
+// switches at 5, 17 and 49 children, shrinking below 4, 13 and 37
+int artTypeFor(int count, bool growing)
+{
+    if(count <= 1) {
+        return -1;
+    }
+    if(growing) {
+        return count <= 4 ? 0 : count <= 16 ? 1 : count <= 48 ? 2 : 3;
+    }
+    return count < 4 ? 0 : count < 13 ? 1 : count < 37 ? 2 : 3;
+}
+
+// ArtMap inner nodes grow through Node4/16/48/256 as children are added
+// and shrink back (with hysteresis) as they are removed, shared key bytes
+// are compressed into the node's prefix, and iteration stays in unsigned
+// key order across the top bit
+bool artLayoutTest()
+{
+    ArtPeek art;
+    std::vector<int> bytes;
+    for(int b = 0; b < 256; b++) {
+        bytes.push_back(b);
+    }
+    srand(37);
+    for(int b = 255; b > 0; b--) {
+        std::swap(bytes[b], bytes[rand() % (b + 1)]);
+    }
+
+    // Keys differ only in the last byte, so the root holds the first three
+    const uint32_t base = 0xABCD1200u;
+    std::map<int,int> ref;
+    bool ok = true;
+    for(int i = 0; i < 256 && ok; i++) {
+        art.insert(std::make_pair(base + bytes[i], i));
+        ref[bytes[i]] = i;
+        ok = art.rootType() == artTypeFor(i + 1, true) && (i == 0 || art.rootPrefixLength() == 3);
+    }
+    std::vector<int> order;
+    for(ArtMap<uint32_t,int>::iterator it = art.begin(); it != art.end(); ++it) {
+        order.push_back(it->first - base);
+    }
+    ok = ok && order == keysOf(ref);
+
+    // A key leaving the shared prefix splits it, and removing it merges
+    // the split node back into the Node256 below
+    art.insert(std::make_pair(0xAB000000u, -1));
+    ok = ok && art.rootType() == 0 && art.rootPrefixLength() == 1;
+    art.remove(0xAB000000u);
+    ok = ok && art.rootType() == 3 && art.rootPrefixLength() == 3;
+
+    for(int i = 255; i >= 0 && ok; i--) {
+        art.remove(base + bytes[i]);
+        ok = art.rootType() == artTypeFor(i, false) && art.find(base + bytes[i]) == art.end();
+        ok = ok && (i == 0 || art.find(base + bytes[0]) != art.end());
+    }
+    ok = ok && art.empty();
+
+    // Byte 0x80 and up must not sort as negative
+    ArtMap<uint64_t,int> wide;
+    const uint64_t keys[] = { 0x8000000000000000ULL, 1, 0x7FFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0x80ULL, 0x7FULL };
+    for(int i = 0; i < 6; i++) {
+        wide.insert(std::make_pair(keys[i], i));
+    }
+    std::vector<uint64_t> sorted(keys, keys + 6), seen;
+    std::sort(sorted.begin(), sorted.end());
+    for(ArtMap<uint64_t,int>::iterator it = wide.begin(); it != wide.end(); ++it) {
+        seen.push_back(it->first);
+    }
+    return ok && seen == sorted;
+}
+
+// Exposes a red-black tree's nodes so a test can recolor one
+class RedBlackPeek : public RedBlackTree<int,int>
+{
+public:
+    RBNode<int,int>* root() const
+    {
+        return static_cast<RBNode<int,int>*>(this->root_);
+    }
+};
+
+// Red-black deletes rotate at most three times each, and the validator
+// checks black heights, not just red-red edges
+bool redBlackDeleteTest()
+{
+    RedBlackPeek rb;
+    std::vector<int> present;
+    srand(31);
+    for(int i = 0; i < 20000; i++) {
+        int k = rand();
+        if(rb.find(k) == rb.end()) {
+            present.push_back(k);
+        }
+        rb.insert(std::make_pair(k, i));
+    }
+    bool ok = true;
+    size_t most = 0;
+    for(int i = 0; i < 30000 && !present.empty(); i++) {
+        if(i % 4 == 3) {
+            int k = rand();
+            if(rb.find(k) == rb.end()) {
+                present.push_back(k);
+            }
+            rb.insert(std::make_pair(k, i));
+            continue;
+        }
+        size_t at = rand() % present.size();
+        size_t before = rb.rotationCount();
+        rb.remove(present[at]);
+        most = std::max(most, rb.rotationCount() - before);
+        present[at] = present.back();
+        present.pop_back();
+    }
+    TreeValidator<int,int> validator(rb);
+    ok = ok && most <= 3 && validator.step(100000) && keysOf(rb).size() == present.size();
+
+    // Turning any red node black lengthens the black paths through it
+    RBNode<int,int>* n = rb.root();
+    while(n != NULL && !n->isRed()) {
+        n = (n->getLeft() != NULL) ? n->getLeft() : n->getRight();
+    }
+    if(n == NULL) {
+        return false;
+    }
+    n->setRed(false);
+    TreeValidator<int,int> broken(rb);
+    ok = ok && !broken.step(100000) && broken.violation() == "children's subtrees have different black heights";
+    n->setRed(true);
+    return ok;
+}
+
+// Collects the items of a tree in iteration order
+template<typename Tree>
+std::vector<std::pair<int,int> > itemsOf(const Tree& tree)
+{
+    std::vector<std::pair<int,int> > items;
+    for(auto it = tree.begin(); it != tree.end(); ++it) {
+        items.push_back(std::make_pair(it->first, it->second));
+    }
+    return items;
+}
+
+template<typename Tree>
+bool holds(const Tree& tree, const std::map<int,int>& ref)
+{
+    TreeValidator<int,int> validator(tree);
+    return itemsOf(tree) == std::vector<std::pair<int,int> >(ref.begin(), ref.end()) && validator.step(100000);
+}
+
+// clone() copies shape and balance data into an independent tree; moves
+// leave the source empty and reusable; swap exchanges two non-empty trees.
+// source and target come in empty, configured the same way.
+template<typename Tree>
+bool cloneMoveSwapTest(Tree& source, Tree& target)
+{
+    std::map<int,int> ref;
+    srand(45);
+    for(int i = 0; i < 500; i++) {
+        int k = rand() % 2000;
+        source.insert(std::make_pair(k, i));
+        ref[k] = i;
+    }
+
+    Tree copy = source.clone();
+    ShapeStats sourceShape = ShapeAnalyzer<int,int>::analyze(source);
+    ShapeStats copyShape = ShapeAnalyzer<int,int>::analyze(copy);
+    bool ok = holds(copy, ref) && copyShape.leafDepthHistogram == sourceShape.leafDepthHistogram;
+    ok = ok && copyShape.averageSearchDepth == sourceShape.averageSearchDepth;
+
+    // The copy is independent of the source
+    std::map<int,int> copyRef(ref);
+    for(int i = 0; i < 300; i++) {
+        int k = rand() % 2000;
+        if(i % 2 == 0) {
+            copy.insert(std::make_pair(k, -i));
+            copyRef[k] = -i;
+        }
+        else {
+            copy.remove(k);
+            copyRef.erase(k);
+        }
+    }
+    ok = ok && holds(copy, copyRef) && holds(source, ref);
+
+    // Move construction empties the source, which stays usable
+    Tree moved(std::move(copy));
+    ok = ok && copy.empty() && copy.begin() == copy.end() && holds(moved, copyRef);
+    copy.insert(std::make_pair(1, 1));
+    std::map<int,int> single;
+    single[1] = 1;
+    ok = ok && holds(copy, single);
+
+    // Move assignment replaces a non-empty target's contents
+    target.insert(std::make_pair(-1, -1));
+    target = std::move(moved);
+    ok = ok && moved.empty() && holds(target, copyRef) && target.find(-1) == target.end();
+    moved.insert(std::make_pair(2, 2));
+    ok = ok && moved.find(2) != moved.end() && moved.find(1) == moved.end();
+
+    // Swapping two non-empty trees
+    source.swap(target);
+    return ok && holds(source, copyRef) && holds(target, ref);
+}
+
+// True if front() and back() match the ends of ref, or both throw on empty
+template<typename Tree>
+bool endsMatch(const Tree& tree, const std::map<int,int>& ref)
+{
+    if(ref.empty()) {
+        int thrown = 0;
+        try { tree.front(); } catch(const std::out_of_range&) { thrown++; }
+        try { tree.back(); } catch(const std::out_of_range&) { thrown++; }
+        return thrown == 2;
+    }
+    return tree.front().first == ref.begin()->first && tree.front().second == ref.begin()->second &&
+           tree.back().first == ref.rbegin()->first && tree.back().second == ref.rbegin()->second;
+}
+
+// Tracks front()/back() through inserts and removes at both ends and in
+// the middle, with lookups in between (which splay in a SplayTree), then
+// drains the tree with pop_front. Trees that rotate must have rotated.
+template<typename Tree>
+bool frontBackTest(Tree& tree, bool rotates)
+{
+    std::map<int,int> ref;
+    bool ok = endsMatch(tree, ref);
+    tree.pop_front();
+    ok = ok && tree.empty();
+
+    srand(46);
+    for(int i = 0; i < 3000 && ok; i++) {
+        int k;
+        switch(rand() % 6) {
+        case 0:
+            k = ref.empty() ? 0 : ref.begin()->first - 1 - rand() % 3;
+            tree.insert(std::make_pair(k, i));
+            ref[k] = i;
+            break;
+        case 1:
+            k = ref.empty() ? 0 : ref.rbegin()->first + 1 + rand() % 3;
+            tree.insert(std::make_pair(k, i));
+            ref[k] = i;
+            break;
+        case 2:
+            if(!ref.empty()) {
+                tree.remove(ref.begin()->first);
+                ref.erase(ref.begin());
+            }
+            break;
+        case 3:
+            if(!ref.empty()) {
+                tree.remove(ref.rbegin()->first);
+                ref.erase(std::prev(ref.end()));
+            }
+            break;
+        case 4:
+            k = rand() % 4000 - 2000;
+            tree.insert(std::make_pair(k, i));
+            ref[k] = i;
+            break;
+        default:
+            k = rand() % 4000 - 2000;
+            tree.find(k);
+            tree.remove(k + 1);
+            ref.erase(k + 1);
+            break;
+        }
+        ok = endsMatch(tree, ref);
+    }
+    ok = ok && (!rotates || tree.rotationCount() > 0);
+
+    std::vector<int> expected, drained;
+    for(std::map<int,int>::const_iterator it = ref.begin(); it != ref.end(); ++it) {
+        expected.push_back(it->first);
+    }
+    while(!tree.empty()) {
+        drained.push_back(tree.front().first);
+        tree.pop_front();
+        ref.erase(ref.begin());
+        ok = ok && endsMatch(tree, ref);
+    }
+    return ok && !drained.empty() && drained == expected;
+}
+
+// Exposes a tree's root so a test can corrupt its nodes
+template<typename Tree>
+class TreePeek : public Tree
+{
+public:
+    Node<int,int>* root() const
+    {
+        return this->root_;
+    }
+};
+
+// Inserts keys 2*lo .. 2*hi (even only), middle first, so the tree is
+// perfectly balanced without any rotations
+template<typename Tree>
+void insertBalanced(Tree& tree, int lo, int hi)
+{
+    if(lo > hi) {
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    tree.insert(std::make_pair(2 * mid, mid));
+    insertBalanced(tree, lo, mid - 1);
+    insertBalanced(tree, mid + 1, hi);
+}
+
+Node<int,int>* nodeAt(Node<int,int>* n, int key)
+{
+    while(n != NULL && n->getKey() != key) {
+        n = key < n->getKey() ? n->getLeft() : n->getRight();
+    }
+    return n;
+}
+
+// Calls step(1) until it reports a violation, at most limit times
+bool stepUntilViolation(TreeValidator<int,int>& validator, int limit)
+{
+    for(int i = 0; i < limit; i++) {
+        if(!validator.step(1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Calls samplePath() until it reports a violation, at most limit times
+bool sampleUntilViolation(TreeValidator<int,int>& validator, int limit)
+{
+    for(int i = 0; i < limit; i++) {
+        if(!validator.samplePath()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Corrupts one node at a time (an out-of-order key, a wrong parent
+// pointer, a wrong AVL balance) and checks that step(1), resumed across
+// calls and across tree mutations, and samplePath() report it at the
+// right key; each corruption is undone before the next
+bool validatorCorruptionTest()
+{
+    TreePeek<BinarySearchTree<int,int> > bst;
+    insertBalanced(bst, 0, 62);
+    TreeValidator<int,int> validator(bst, 28);
+    bool ok = !stepUntilViolation(validator, 200) && validator.sweeps() == 3 && !sampleUntilViolation(validator, 200);
+
+    // 41 as the left child of leaf 40: in order with its in-order
+    // neighbours, but not with its parent
+    Node<int,int>* leaf = nodeAt(bst.root(), 40);
+    Node<int,int>* stray = new Node<int,int>(41, 0, leaf);
+    leaf->setLeft(stray);
+    ok = ok && stepUntilViolation(validator, 200) && !validator.ok() && !validator.step(1);
+    ok = ok && validator.violationKey() == "41" && validator.violation() == "left child's key is not less than its parent's";
+    validator.reset();
+    ok = ok && sampleUntilViolation(validator, 2000) && validator.violationKey() == "41";
+    leaf->setLeft(NULL);
+    delete stray;
+    validator.reset();
+    ok = ok && !stepUntilViolation(validator, 200);
+
+    // Stop partway through a sweep, then reshape the tree, removing the
+    // key the sweep stopped at: the sweep must carry on without false alarms
+    size_t sweeps = validator.sweeps();
+    for(int i = 0; i < 20; i++) {
+        validator.step(1);
+    }
+    for(int k = 30; k < 50; k += 2) {
+        bst.remove(k);
+    }
+    for(int k = 1; k < 126; k += 8) {
+        bst.insert(std::make_pair(k, k));
+    }
+    ok = ok && validator.step(1) && validator.sweeps() == sweeps;
+    while(ok && validator.sweeps() < sweeps + 2) {
+        ok = validator.step(1);
+    }
+
+    // A wrong parent behind the cursor is found after wrapping around
+    for(int i = 0; i < 40; i++) {
+        validator.step(1);
+    }
+    Node<int,int>* child = nodeAt(bst.root(), 9);
+    Node<int,int>* parent = child->getParent();
+    child->setParent(bst.root());
+    ok = ok && stepUntilViolation(validator, 200) && validator.violationKey() == "9";
+    validator.reset();
+    ok = ok && sampleUntilViolation(validator, 2000) && validator.violationKey() == "9";
+    child->setParent(parent);
+    validator.reset();
+    ok = ok && !stepUntilViolation(validator, 200) && !sampleUntilViolation(validator, 200);
+
+    // A wrong balance, at the root and three levels below it
+    TreePeek<AVLTree<int,int> > avl;
+    insertBalanced(avl, 0, 62);
+    TreeValidator<int,int> avlValidator(avl, 29);
+    AVLNode<int,int>* top = static_cast<AVLNode<int,int>*>(avl.root());
+    top->setBalance(1);
+    ok = ok && !avlValidator.samplePath() && avlValidator.violationKey() == "62";
+    ok = ok && avlValidator.violation() == "AVL balance does not match subtree heights";
+    top->setBalance(0);
+    avlValidator.reset();
+    AVLNode<int,int>* inner = static_cast<AVLNode<int,int>*>(nodeAt(avl.root(), 86));
+    inner->setBalance(-1);
+    ok = ok && stepUntilViolation(avlValidator, 200) && avlValidator.violationKey() == "86";
+    avlValidator.reset();
+    ok = ok && sampleUntilViolation(avlValidator, 2000) && avlValidator.violationKey() == "86";
+    inner->setBalance(0);
+    avlValidator.reset();
+    return ok && !stepUntilViolation(avlValidator, 200);
+}
+
+int depthOf(Node<int,int>* n)
+{
+    int depth = 0;
+    for(; n->getParent() != NULL; n = n->getParent()) {
+        depth++;
+    }
+    return depth;
+}
+
+// Every non-const access splays: the key touched (or, for a missing key,
+// a neighbour of it) ends up at the root, and a small hot set stays
+// near the top of a large tree
+bool splayTest()
+{
+    TreePeek<SplayTree<int,int> > splay;
+    std::map<int,int> ref;
+    bool ok = true;
+    srand(30);
+    for(int i = 0; i < 5000 && ok; i++) {
+        int k = rand() % 20000;
+        splay.insert(std::make_pair(k, i));
+        ref[k] = i;
+        ok = splay.root()->getKey() == k;
+    }
+    for(int i = 0; i < 2000 && ok; i++) {
+        int k = rand() % 20000;
+        std::map<int,int>::iterator at = ref.lower_bound(k);
+        bool present = at != ref.end() && at->first == k;
+        if(i % 3 == 0) {
+            ok = (splay.find(static_cast<long long>(k)) != splay.end()) == present;
+        }
+        else if(present) {
+            ok = splay[k] == at->second;
+        }
+        else {
+            ok = splay.find(k) == splay.end();
+        }
+        // A miss splays the last node on the search path, which is the
+        // missing key's predecessor or successor
+        int root = splay.root()->getKey();
+        ok = ok && (root == k || (at != ref.end() && root == at->first) ||
+                    (at != ref.begin() && root == std::prev(at)->first));
+    }
+
+    // Const lookups leave the shape alone
+    const SplayTree<int,int>& still = splay;
+    int root = splay.root()->getKey();
+    ok = ok && still.find(ref.begin()->first) != still.end() && splay.root()->getKey() == root;
+
+    // Removing a key splays its neighbourhood and keeps the rest in order
+    for(int i = 0; i < 1000; i++) {
+        int k = rand() % 20000;
+        splay.remove(k);
+        ref.erase(k);
+    }
+    ok = ok && findsMatch(splay, ref);
+
+    // Skewed access: 8 hot keys among thousands, interleaved with cold
+    // lookups, stay within a few levels of the root
+    std::vector<int> hot;
+    for(std::map<int,int>::iterator it = ref.begin(); hot.size() < 8; std::advance(it, ref.size() / 10)) {
+        hot.push_back(it->first);
+    }
+    for(int round = 0; round < 200; round++) {
+        for(size_t h = 0; h < hot.size(); h++) {
+            splay.find(hot[h]);
+        }
+        splay.find(rand() % 20000);
+    }
+    int deepest = 0;
+    for(size_t h = 0; h < hot.size(); h++) {
+        deepest = std::max(deepest, depthOf(nodeAt(splay.root(), hot[h])));
+    }
+    TreeValidator<int,int> validator(splay);
+    return ok && deepest <= 12 && splay.height() > 2 * deepest && validator.step(100000);
+}
+
+// Runs the same mixed insert/remove stream on a tree, recording the
+// most rotations any single insert and remove took
+template<typename Tree>
+size_t mixedRotations(Tree& tree, size_t& mostPerInsert, size_t& mostPerRemove)
+{
+    mostPerInsert = mostPerRemove = 0;
+    srand(131);
+    for(int i = 0; i < 40000; i++) {
+        int k = rand() % 10000;
+        size_t before = tree.rotationCount();
+        if(i < 5000 || rand() % 2 == 0) {
+            tree.insert(std::make_pair(k, i));
+            mostPerInsert = std::max(mostPerInsert, tree.rotationCount() - before);
+        }
+        else {
+            tree.remove(k);
+            mostPerRemove = std::max(mostPerRemove, tree.rotationCount() - before);
+        }
+    }
+    return tree.rotationCount();
+}
+
+// Red-black inserts rotate at most twice and removes at most three times,
+// and the tree rotates less than AVLTree on the same write-heavy stream
+bool redBlackRotationTest()
+{
+    RedBlackTree<int,int> rb;
+    AVLTree<int,int> avl;
+    size_t rbInsert, rbRemove, avlInsert, avlRemove;
+    size_t rbTotal = mixedRotations(rb, rbInsert, rbRemove);
+    size_t avlTotal = mixedRotations(avl, avlInsert, avlRemove);
+    TreeValidator<int,int> validator(rb);
+    return rbInsert <= 2 && rbRemove <= 3 && rbTotal < avlTotal && keysOf(rb) == keysOf(avl) && validator.step(100000);
+}
+
+// Rank-balanced mode builds exactly the AVL shape from inserts alone, and
+// rebalances with at most two rotations per update where AVL removes
+// cascade
+bool wavlRebalanceTest()
+{
+    AVLTree<int,int> avl;
+    AVLTree<int,int> wavl(true);
+    srand(32);
+    for(int i = 0; i < 20000; i++) {
+        int k = rand() % 50000;
+        avl.insert(std::make_pair(k, i));
+        wavl.insert(std::make_pair(k, i));
+    }
+    ShapeStats avlShape = ShapeAnalyzer<int,int>::analyze(avl);
+    ShapeStats wavlShape = ShapeAnalyzer<int,int>::analyze(wavl);
+    bool ok = wavl.height() == avl.height() && wavl.rotationCount() == avl.rotationCount();
+    ok = ok && wavlShape.leafDepthHistogram == avlShape.leafDepthHistogram;
+
+    AVLTree<int,int> avlMixed;
+    AVLTree<int,int> wavlMixed(true);
+    size_t avlInsert, avlRemove, wavlInsert, wavlRemove;
+    size_t avlTotal = mixedRotations(avlMixed, avlInsert, avlRemove);
+    size_t wavlTotal = mixedRotations(wavlMixed, wavlInsert, wavlRemove);
+    TreeValidator<int,int> validator(wavlMixed);
+    return ok && wavlInsert <= 2 && wavlRemove <= 2 && avlRemove > 2 && wavlTotal < avlTotal &&
+           keysOf(wavlMixed) == keysOf(avlMixed) && validator.step(100000);
+}
+
+// Treap bulk operations: eraseRange frees a split-out middle (with every
+// key cached beforehand, so a stale cache slot would show), and
+// insertRange appends sorted runs along the right spine, falling back
+// to insert for keys below the maximum
+bool treapBulkTest()
+{
+    Treap<int,int> treap(33);
+    std::map<int,int> ref;
+    treap.setLookupCache(256);
+    bool ok = eraseRangeTest(treap);
+
+    std::vector<std::pair<int,int> > run;
+    for(int i = 0; i < 3000; i++) {
+        run.push_back(std::make_pair(i * 3, i));
+    }
+    // Out-of-order keys in the middle of the run, one of them a duplicate
+    run[1000] = std::make_pair(10, -1);
+    run[2000] = std::make_pair(1501, -2);
+    for(size_t i = 0; i < run.size(); i++) {
+        ref[run[i].first] = run[i].second;
+    }
+    treap.insertRange(run.begin(), run.end());
+    TreeValidator<int,int> validator(treap);
+    ok = ok && findsMatch(treap, ref) && validator.step(100000);
+
+    srand(133);
+    for(int i = 0; i < 100 && ok; i++) {
+        int lo = rand() % 9200 - 100;
+        int hi = lo + rand() % 300;
+        ok = eraseRangeMatches(treap, ref, lo, hi) && findsMatch(treap, ref);
+    }
+    validator.reset();
+    // Expected height is about 3 ln n; a spine-shaped treap would be far taller
+    return ok && validator.step(100000) && treap.height() < 60 && treap.cacheHits() > 0;
+}
+
+// Average key comparisons per insert of keys first, first + step, ... (n
+// of them), inserting through the finger, the hint end() or from the root
+enum InsertStart { FROM_ROOT, FROM_FINGER, FROM_END_HINT };
+
+double comparisonsPerInsert(AVLTree<int,int>& tree, InsertStart start, int first, int step, int n)
+{
+    tree.setFingerSearch(start == FROM_FINGER);
+    tree.resetSearchComparisons();
+    for(int i = 0; i < n; i++) {
+        std::pair<const int,int> item(first + i * step, i);
+        if(start == FROM_END_HINT) {
+            tree.insert(tree.end(), item);
+        }
+        else {
+            tree.insert(item);
+        }
+    }
+    return static_cast<double>(tree.searchComparisons()) / n;
+}
+
+// Appends through the finger or an end() hint take O(1) comparisons each
+// where inserts from the root take about log n, and keys landing a few
+// items from the finger take O(log d)
+bool fingerSearchTest()
+{
+    const int N = 1 << 16;
+    AVLTree<int,int> rooted, fingered, hinted, wavl(true);
+    wavl.setFingerSearch(true);
+    double fromRoot = comparisonsPerInsert(rooted, FROM_ROOT, 0, 4, N);
+    double fromFinger = comparisonsPerInsert(fingered, FROM_FINGER, 0, 4, N);
+    double fromHint = comparisonsPerInsert(hinted, FROM_END_HINT, 0, 4, N);
+    double fromWavlFinger = comparisonsPerInsert(wavl, FROM_FINGER, 0, 4, N);
+    bool ok = fromRoot > 14 && fromFinger <= 2 && fromHint <= 2 && fromWavlFinger <= 2;
+
+    // A second, interleaved pass fills the gaps left to right: each key
+    // lands next to the previous one, a short climb from the finger
+    double nearRoot = comparisonsPerInsert(rooted, FROM_ROOT, 1, 4, N);
+    double nearFinger = comparisonsPerInsert(fingered, FROM_FINGER, 1, 4, N);
+    ok = ok && nearRoot > 14 && nearFinger < 8;
+
+    // The count moves with the tree, like rotationCount()
+    size_t counted = fingered.searchComparisons();
+    AVLTree<int,int> moved(std::move(fingered));
+    ok = ok && counted > 0 && moved.searchComparisons() == counted;
+
+    TreeValidator<int,int> validator(moved);
+    TreeValidator<int,int> wavlValidator(wavl);
+    return ok && keysOf(moved) == keysOf(rooted) && keysOf(hinted).size() == N &&
+           validator.step(1000000) && wavlValidator.step(1000000);
+}
+
+// Height in nodes is at most floor(log_{1/alpha}(n)) + 1 after inserts;
+// slack allows for removes, which may shrink n to alpha times its peak
+// before the tree is rebuilt
+bool withinScapegoatBound(const BinarySearchTree<int,int>& tree, size_t n, double alpha, int slack)
+{
+    int bound = static_cast<int>(std::floor(std::log(static_cast<double>(n)) / -std::log(alpha) + 1e-9)) + 1 + slack;
+    return n == 0 || tree.height() <= bound;
+}
+
+// Scapegoat mode keeps sorted input (ascending and descending) within the
+// alpha height bound at every size checked, without rotations, and stays
+// within it as removes shrink the tree
+bool scapegoatHeightTest()
+{
+    const double alphas[] = { 0.55, 0.7, 0.9 };
+    bool ok = true;
+    for(int a = 0; a < 3 && ok; a++) {
+        BinarySearchTree<int,int> ascending, descending;
+        ascending.setScapegoat(alphas[a]);
+        descending.setScapegoat(alphas[a]);
+        const int N = 8192;
+        for(int n = 1; n <= N && ok; n++) {
+            ascending.insert(std::make_pair(n, n));
+            descending.insert(std::make_pair(-n, n));
+            if((n & (n - 1)) == 0 || n % 500 == 0) {
+                ok = withinScapegoatBound(ascending, n, alphas[a], 0) && withinScapegoatBound(descending, n, alphas[a], 0);
+            }
+        }
+        ok = ok && ascending.rotationCount() == 0 && descending.rotationCount() == 0;
+
+        // Remove from the low end, so the rest would lean without rebuilds
+        for(int n = 1; n < N && ok; n++) {
+            ascending.remove(n);
+            if(n % 500 == 0) {
+                ok = withinScapegoatBound(ascending, N - n, alphas[a], 1);
+            }
+        }
+        TreeValidator<int,int> validator(ascending);
+        ok = ok && validator.step(100000) && ascending.front().first == N;
+    }
+
+    // The plain tree degenerates on the same input
+    BinarySearchTree<int,int> plain;
+    for(int n = 1; n <= 1000; n++) {
+        plain.insert(std::make_pair(n, n));
+    }
+    return ok && plain.height() == 1000;
+}
 
 int main(int argc, char *argv[])
 {
@@ -44,5 +1705,106 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
-    return 0;
+    cout << endl;
+    report("Background clear", clearInBackgroundTest());
+    report("Export", exportTest());
+    report("Shape statistics", shapeTest());
+
+    BinarySearchTree<int,int> bstEnds;
+    report("BST front/back/pop_front", frontBackTest(bstEnds, false));
+    AVLTree<int,int> avlEnds;
+    report("AVL front/back/pop_front", frontBackTest(avlEnds, true));
+    RedBlackTree<int,int> rbEnds;
+    report("Red-black front/back/pop_front", frontBackTest(rbEnds, true));
+    SplayTree<int,int> splayEnds;
+    report("Splay front/back/pop_front", frontBackTest(splayEnds, true));
+
+    BinarySearchTree<int,int> bstSource, bstTarget;
+    report("BST clone/move/swap", cloneMoveSwapTest(bstSource, bstTarget));
+    AVLTree<int,int> avlSource, avlTarget;
+    report("AVL clone/move/swap", cloneMoveSwapTest(avlSource, avlTarget));
+    AVLTree<int,int> wavlSource(true), wavlTarget(true);
+    report("WAVL clone/move/swap", cloneMoveSwapTest(wavlSource, wavlTarget) && wavlSource.isRankBalanced());
+    RedBlackTree<int,int> rbSource, rbTarget;
+    report("Red-black clone/move/swap", cloneMoveSwapTest(rbSource, rbTarget));
+    Treap<int,int> treapSource, treapTarget(7);
+    report("Treap clone/move/swap", cloneMoveSwapTest(treapSource, treapTarget));
+    report("Multimap", multimapTest());
+    report("Tombstones", tombstoneTest());
+
+    AVLTree<int,int> avlRange;
+    report("AVL eraseRange", eraseRangeTest(avlRange));
+    AVLTree<int,int> wavlRange(true);
+    report("WAVL eraseRange", eraseRangeTest(wavlRange));
+    AVLTree<int,int> tombRange;
+    tombRange.setTombstones(0.3);
+    report("Tombstone eraseRange", eraseRangeTest(tombRange));
+    report("Compact", compactTest());
+
+    BinarySearchTree<int,int> bstCache;
+    report("BST cache", cacheTest(bstCache));
+    BinarySearchTree<int,int> scapegoatCache;
+    scapegoatCache.setScapegoat(0.6);
+    report("Scapegoat cache", cacheTest(scapegoatCache));
+    AVLTree<int,int> avlCache;
+    report("AVL cache", cacheTest(avlCache));
+    AVLTree<int,int> wavlCache(true);
+    report("WAVL cache", cacheTest(wavlCache));
+    report("AVL cache rebuild/compact", avlCacheTest());
+    BinarySearchTree<std::string,int> bstWords;
+    BinarySearchTree<int,int> bstNumbers;
+    report("BST heterogeneous lookups", heterogeneousTest(bstWords, bstNumbers));
+    AVLTree<std::string,int> avlWords;
+    AVLTree<int,int> avlNumbers;
+    report("AVL heterogeneous lookups", heterogeneousTest(avlWords, avlNumbers));
+
+    BinarySearchTree<int,int> bstDiff;
+    report("BST vs std::map", checkedDifferentialTest(bstDiff, 1));
+    AVLTree<int,int> avlDiff;
+    report("AVL vs std::map", checkedDifferentialTest(avlDiff, 2));
+    SplayTree<int,int> splayDiff;
+    report("Splay vs std::map", checkedDifferentialTest(splayDiff, 3));
+    report("Splay brings accessed keys up", splayTest());
+    BinarySearchTree<int,int,std::greater<int> > bstGreater;
+    std::map<int,int,std::greater<int> > bstGreaterRef;
+    report("BST greater<int> vs std::map", comparatorDifferentialTest(bstGreater, bstGreaterRef, identityKey, 35));
+    AVLTree<int,int,std::greater<int> > avlGreater;
+    std::map<int,int,std::greater<int> > avlGreaterRef;
+    report("AVL greater<int> vs std::map", comparatorDifferentialTest(avlGreater, avlGreaterRef, identityKey, 36) &&
+           avlGreater.front().first > avlGreater.back().first);
+    BinarySearchTree<std::string,int> bstWordsDiff;
+    std::map<std::string,int> bstWordsRef;
+    report("BST string keys vs std::map", comparatorDifferentialTest(bstWordsDiff, bstWordsRef, wordKey, 37));
+    AVLTree<std::string,int> avlWordsDiff;
+    std::map<std::string,int> avlWordsRef;
+    avlWordsDiff.setLookupCache(64);
+    report("AVL string keys vs std::map", comparatorDifferentialTest(avlWordsDiff, avlWordsRef, wordKey, 38));
+    RedBlackTree<int,int> rbDiff;
+    report("Red-black vs std::map", checkedDifferentialTest(rbDiff, 4));
+    report("Validator finds corruption", validatorCorruptionTest());
+    report("Red-black rotations vs AVL", redBlackRotationTest());
+    report("Red-black deletes", redBlackDeleteTest());
+    AVLTree<int,int> wavlDiff(true);
+    report("WAVL rebalancing", wavlRebalanceTest());
+    report("WAVL vs std::map", checkedDifferentialTest(wavlDiff, 5) && wavlDiff.isRankBalanced());
+    Treap<int,int> treapDiff;
+    report("Treap vs std::map", checkedDifferentialTest(treapDiff, 6));
+    report("Treap eraseRange/insertRange", treapBulkTest());
+    report("Treap split/merge/union", treapSplitMergeTest());
+    report("RadixMap vs std::map", radixDifferentialTest());
+    report("RadixMap prefix compression", radixCompressionTest());
+    ArtMap<uint32_t,int> artDiff;
+    report("ArtMap vs std::map", differentialTest(artDiff, 7));
+    report("ArtMap node layouts", artLayoutTest());
+    AVLTree<int,int> fingerDiff;
+    fingerDiff.setFingerSearch(true);
+    report("Finger AVL vs std::map", checkedDifferentialTest(fingerDiff, 8));
+    report("Finger and hinted inserts", fingerSearchTest());
+    BinarySearchTree<int,int> scapegoatDiff;
+    scapegoatDiff.setScapegoat(0.7);
+    report("Scapegoat vs std::map", checkedDifferentialTest(scapegoatDiff, 9) &&
+           withinScapegoatBound(scapegoatDiff, keysOf(scapegoatDiff).size(), 0.7, 1));
+    report("Scapegoat height on sorted input", scapegoatHeightTest());
+
+    return failures == 0 ? 0 : 1;
 }
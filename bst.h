@@ -8,6 +8,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Only clearInBackground() uses it; include thread-pool.h where that is called
+class ThreadPool;
 
 /**
  * A templated class for a Node in a search tree.
@@ -38,6 +46,10 @@ public:
     void setRight(Node<Key, Value>* right);
     void setValue(const Value &value);
 
+    // True for a node that was removed lazily and is only kept as a
+    // tombstone (see AVLTree::setTombstones); plain nodes never are
+    virtual bool isDead() const;
+
 protected:
     std::pair<const Key, Value> item_;
     Node<Key, Value>* parent_;
@@ -75,6 +87,12 @@ Node<Key, Value>::~Node()
 
 }
 
+template<typename Key, typename Value>
+bool Node<Key, Value>::isDead() const
+{
+    return false;
+}
+
 /**
 * A const getter for the item.
 */
@@ -189,24 +207,224 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* Three-way key comparison used by the tree descents: returns a negative
+* value if a orders before b, zero if they are equivalent and a positive
+* value otherwise, so each level of a descent needs a single call.
+*
+* The general version asks Compare at most twice. std::less gets cheaper
+* specializations below: strings use a single compare() and integral keys
+* a branch-free constexpr difference.
+*/
+template<typename Key, typename Compare>
+struct KeyCompare
+{
+    template<typename A, typename B>
+    static int compare(const Compare& comp, const A& a, const B& b)
+    {
+        return comp(a, b) ? -1 : (comp(b, a) ? 1 : 0);
+    }
+};
+
+// std::less<Key>: compare with operator< directly, which also lets
+// heterogeneous lookups use any type comparable with Key
+template<typename Key, bool Integral = std::is_integral<Key>::value>
+struct LessCompare
+{
+    template<typename A, typename B>
+    static constexpr int compare(const std::less<Key>&, const A& a, const B& b)
+    {
+        return (a < b) ? -1 : ((b < a) ? 1 : 0);
+    }
+};
+
+template<typename Key>
+struct LessCompare<Key, true> : LessCompare<Key, false>
+{
+    using LessCompare<Key, false>::compare;
+    static constexpr int compare(const std::less<Key>&, Key a, Key b)
+    {
+        return (b < a) - (a < b);
+    }
+};
+
+template<typename Key>
+struct KeyCompare<Key, std::less<Key> > : LessCompare<Key>
+{
+
+};
+
+template<typename CharT, typename Traits, typename Alloc>
+struct KeyCompare<std::basic_string<CharT, Traits, Alloc>, std::less<std::basic_string<CharT, Traits, Alloc> > >
+    : LessCompare<std::basic_string<CharT, Traits, Alloc> >
+{
+    typedef std::basic_string<CharT, Traits, Alloc> String;
+    typedef std::less<String> Less;
+
+    using LessCompare<String>::compare;
+    static int compare(const Less&, const String& a, const String& b)
+    {
+        return a.compare(b);
+    }
+    static int compare(const Less&, const String& a, const CharT* b)
+    {
+        return a.compare(b);
+    }
+    static int compare(const Less&, const CharT* a, const String& b)
+    {
+        int c = b.compare(a);
+        return (c < 0) - (c > 0);
+    }
+};
+
+/**
+* Hash for the lookup cache (see BinarySearchTree::setLookupCache). Only
+* integral and std::basic_string keys ordered by std::less have one, since
+* there equivalent keys are equal keys and hash alike; other trees leave
+* the cache off.
+*/
+template<typename Key, bool Integral = std::is_integral<Key>::value>
+struct KeyHash
+{
+    static const bool enabled = false;
+    static uint64_t hash(const Key&) { return 0; }
+};
+
+template<typename Key>
+struct KeyHash<Key, true>
+{
+    static const bool enabled = true;
+    static uint64_t hash(Key k) { return static_cast<uint64_t>(k); }
+};
+
+template<typename CharT>
+struct KeyHash<std::basic_string<CharT>, false>
+{
+    static const bool enabled = true;
+    static uint64_t hash(const std::basic_string<CharT>& s) { return std::hash<std::basic_string<CharT> >()(s); }
+};
+
+template<typename Key, typename Compare>
+struct LookupHash
+{
+    static const bool enabled = false;
+    static uint64_t hash(const Key&) { return 0; }
+};
+
+template<typename Key>
+struct LookupHash<Key, std::less<Key> > : KeyHash<Key>
+{
+
+};
+
 /**
 * A templated unbalanced binary search tree.
+* Keys are ordered by Compare (std::less<Key> by default).
+*
+* With setScapegoat(alpha) the tree keeps itself balanced the scapegoat
+* way: it counts its nodes, and an insert that lands deeper than
+* log_{1/alpha}(n) walks back up to the lowest ancestor whose larger child
+* holds more than alpha of its nodes and relinks that subtree perfectly
+* balanced in O(size). Removes rebuild the whole tree once it shrinks
+* below alpha times its peak size. Height stays O(log n) and updates cost
+* O(log n) amortized, with no balance data in the nodes and no rotations.
+*
+* setLookupCache(slots) puts a direct-mapped cache from key to node, with
+* CLOCK-style second chances, in front of find(const Key&) and operator[],
+* for skewed lookups that keep asking for the same few keys. A hit costs one hash and one comparison
+* instead of a descent. Every node is dropped from the cache before it is
+* freed; nodeSwap moves nodes without changing their keys, so it needs no
+* invalidation. With the cache on, const lookups write to it, so
+* concurrent readers need outside synchronization.
 */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Compare = std::less<Key> >
 class BinarySearchTree
 {
 public:
     BinarySearchTree(); //TODO
+    explicit BinarySearchTree(const Compare& comp);
+    // Moves take other's nodes in O(1) and leave other empty. Trees are
+    // not copyable; use clone() for a deep copy.
+    BinarySearchTree(BinarySearchTree&& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other);
     virtual ~BinarySearchTree(); //TODO
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
-    bool isBalanced() const; //TODO
+    // Heterogeneous versions: K is any type Compare accepts alongside Key
+    // (with std::less, anything comparable with Key using <, e.g. const
+    // char* for std::string keys), so no temporary Key is constructed
+    template<typename K>
+    void remove(const K& key);
+    virtual void clear(); //TODO
+    // Empties the tree right away and frees the old nodes on pool, so a
+    // large teardown does not stall the caller. A template so that only
+    // callers need the full ThreadPool definition.
+    template<typename Pool = ThreadPool>
+    void clearInBackground(Pool& pool);
+    virtual bool isBalanced() const; //TODO
+
+    // Scapegoat mode (see above), for alpha in (0.5, 1); smaller values
+    // keep the tree flatter at the cost of more rebuilds. Turning it on
+    // rebalances the current nodes in O(n), and 0 turns it off. Only
+    // BinarySearchTree's own insert and remove use it; the self-balancing
+    // trees ignore it.
+    void setScapegoat(double alpha);
+    double scapegoat() const;
+
+    // Lookup cache (see above) with slots rounded up to a power of two;
+    // 0 turns it off. Has no effect for keys without a LookupHash.
+    // Heterogeneous find(const K&) uses it only for integral K whose value
+    // fits in an integral Key; other K (e.g. const char* for std::string
+    // keys) bypass it, since making a Key to hash would allocate.
+    void setLookupCache(size_t slots);
+    size_t cacheHits() const;
+    size_t cacheMisses() const;
+    void resetCacheStats();
+    virtual int height() const;
     void print() const;
     bool empty() const;
-
-    template<typename PPKey, typename PPValue>
-    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    Compare key_comp() const;
+
+    // Smallest and largest items and removal of the smallest, in O(1)
+    // from cached end pointers (pop_front also pays for the removal's
+    // rebalancing). front() and back() throw std::out_of_range if empty.
+    std::pair<const Key, Value>& front() const;
+    std::pair<const Key, Value>& back() const;
+    void pop_front();
+
+    // Items with lo <= key < hi. countRange walks them in O(log n + k).
+    // eraseRange returns how many it erased; this version erases them
+    // one at a time, and the balanced trees override it to cut the range
+    // out as whole subtrees in O(log n + k).
+    size_t countRange(const Key& lo, const Key& hi) const;
+    virtual size_t eraseRange(const Key& lo, const Key& hi);
+
+    // Exchanges contents with other in O(1). Subclasses with state of their
+    // own hide this with a swap of their own type.
+    void swap(BinarySearchTree& other);
+    // Deep copy with the same shape, made node by node in O(n) without
+    // re-inserting. The copy's rotation count starts at zero.
+    BinarySearchTree clone() const;
+
+    // Instrumentation: number of rotations performed since construction
+    // or the last resetRotationCount()
+    size_t rotationCount() const;
+    void resetRotationCount();
+
+    // Streaming exporters for trees too large for print() (see print_bst.h).
+    // The Subtree versions export only the subtree rooted at subtreeKey.
+    // maxDepth and maxNodes limit the output; 0 means unlimited.
+    void exportDot(std::ostream& os, int maxDepth = 0, size_t maxNodes = 0) const;
+    void exportSubtreeDot(std::ostream& os, const Key& subtreeKey, int maxDepth = 0, size_t maxNodes = 0) const;
+    void exportJson(std::ostream& os, int maxDepth = 0, size_t maxNodes = 0) const;
+    void exportSubtreeJson(std::ostream& os, const Key& subtreeKey, int maxDepth = 0, size_t maxNodes = 0) const;
+
+    template<typename PPKey, typename PPValue, typename PPCompare>
+    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue, PPCompare> & tree);
+    template<typename VKey, typename VValue, typename VCompare>
+    friend class TreeValidator;
+    template<typename SKey, typename SValue, typename SCompare>
+    friend class ShapeAnalyzer;
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -225,15 +443,23 @@ public:
         iterator& operator++();
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
+        friend class BinarySearchTree<Key, Value, Compare>;
         iterator(Node<Key,Value>* ptr);
+        iterator(Node<Key,Value>* ptr, bool skipDead);
         Node<Key, Value> *current_;
+        bool skipDead_;     // the tree has tombstones for ++ to step over
     };
 
 public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    template<typename K>
+    iterator find(const K& key) const;
+    // First item whose key is not less than key, or end()
+    iterator lower_bound(const Key& key) const;
+    template<typename K>
+    iterator lower_bound(const K& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
@@ -245,8 +471,14 @@ protected:
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
 
+    // Lets subclasses hand out iterators to nodes they located themselves,
+    // and recover the node behind an iterator they were given
+    iterator makeIterator(Node<Key, Value>* n) const;
+    static Node<Key, Value>* iteratorNode(const iterator& it);
+
     // Provided helper functions
     virtual void printRoot (Node<Key, Value> *r) const;
+    void exportRoot(Node<Key, Value>* r, std::ostream& os, bool json, int maxDepth, size_t maxNodes) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
 
     // Add helper functions here
@@ -263,24 +495,107 @@ protected:
     // Helper function for clearing tree
     void clearHelper(Node<Key, Value>* current);
 
-    // Helper function for inserting into tree
-    void insertHelper(Node<Key, Value>* current, Node<Key, Value>* newNode);
+    // Frees every node under root with release(node) without unlinking
+    // them first. Iterative, so any depth is fine.
+    template<typename Free>
+    static void freeSubtree(Node<Key, Value>* root, Free release);
+
+    // Frees one node during a remove: drops it from the lookup cache, then
+    // releases it
+    void destroyNode(Node<Key, Value>* n);
+
+    // Frees one node without touching the lookup cache; clear() uses it
+    // directly and flushes the cache once. Override to hand nodes back to
+    // a pool; since the base destructor cannot reach the override, such a
+    // subclass must call clear() from its own destructor.
+    virtual void releaseNode(Node<Key, Value>* n);
 
-    // Helper function for removal
-    void removeHelper(Node<Key, Value>* current, const Key& key);
+    // Empties the tree and returns a task that frees the old nodes, or an
+    // empty function if there were none. The task runs after the tree may
+    // be gone, so it frees with delete rather than releaseNode();
+    // subclasses that override releaseNode override this too.
+    virtual std::function<void()> detachNodes();
 
-    // Helper function for internalFind
-    Node<Key, Value>* findHelper(Node<Key, Value>* current, const Key& key) const;
+    // Allocates a copy of n (key, value and any balancing data) below
+    // parent, leaving its children unset. Used by clone().
+    virtual Node<Key, Value>* copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const;
 
-    // Helper function for isBalanced
-    int findHeight(Node<Key, Value>* current, int height) const;
+    // Fills the empty tree copy with copies of this tree's nodes, in the
+    // same shape, using copyNode
+    void copyInto(BinarySearchTree& copy) const;
 
-    // Helper function for isBalanced
-    bool balancedHelper(Node<Key, Value>* current, int length) const;
+    // Helper function for inserting into tree
+    // (returns the node that holds newNode's key afterwards)
+    Node<Key, Value>* insertHelper(Node<Key, Value>* current, Node<Key, Value>* newNode);
+
+    // Upkeep of minNode_ and maxNode_. Every insert path calls
+    // noteInserted with the node now holding the key (new or revived),
+    // every eraseNode calls noteErasing before touching the tree, and
+    // operations that relink many nodes at once call resetEnds.
+    void noteInserted(Node<Key, Value>* n);
+    void noteErasing(Node<Key, Value>* n);
+    void resetEnds();
+
+    // Removes a node known to be in the tree. Overridden by the
+    // self-balancing trees to rebalance afterwards.
+    virtual void eraseNode(Node<Key, Value>* current);
+
+    // Three-way comparison of keys (or heterogeneous lookup keys) by Compare
+    template<typename A, typename B>
+    int compareKeys(const A& a, const B& b) const;
+
+    // Lookup helpers for internalFind, find, lower_bound and remove
+    template<typename K>
+    Node<Key, Value>* findNode(const K& key) const;
+    template<typename K>
+    Node<Key, Value>* lowerBoundNode(const K& key) const;
+
+    // Helper function for isBalanced and height
+    // Computes the height of the subtree in a single post-order pass and
+    // clears balanced if any node's children differ in height by more than one
+    static int heightAndBalance(Node<Key, Value>* current, bool& balanced, bool stopEarly);
+
+    // Rotations shared by the self-balancing trees.
+    // Moves rChild (lChild) up into current's place; current becomes its left (right) child.
+    void leftRotate(Node<Key, Value>* current, Node<Key, Value>* rChild);
+    void rightRotate(Node<Key, Value>* current, Node<Key, Value>* lChild);
+
+    // Called after every rotation with the node that moved down and the one
+    // that replaced it, so subclasses can refresh per-node aggregates
+    virtual void rotated(Node<Key, Value>* down, Node<Key, Value>* up);
+
+    // Links the in-order nodes[lo, hi) into a perfectly balanced subtree
+    // below parent and returns its root; height receives its height.
+    // relinked() is called for every node once its children are in place.
+    Node<Key, Value>* linkBalanced(const std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi,
+                                   Node<Key, Value>* parent, int& height);
+    virtual void relinked(Node<Key, Value>* n, int leftHeight, int rightHeight);
 
     // Helper function to promote a node
     void promoteNode(Node<Key, Value>* current, Node<Key, Value>* parent, Node<Key, Value>* child);
 
+    // Scapegoat-mode insert: an iterative descent that also measures the
+    // new node's depth, then rebuilds above it if that is too deep
+    void scapegoatInsert(const std::pair<const Key, Value>& keyValuePair);
+    // Relinks the count nodes under top perfectly balanced in its place
+    void rebuildSubtree(Node<Key, Value>* top, size_t count);
+    // Number of nodes under root, without recursion
+    static size_t countNodes(Node<Key, Value>* root);
+
+    // internalFind through the lookup cache, filling it on a miss
+    Node<Key, Value>* cachedFind(const Key& key) const;
+    // findNode for find(const K&): through the cache when K is integral
+    // (true_type) and key converts to Key unchanged, else straight
+    template<typename K>
+    Node<Key, Value>* heterogeneousFind(const K& key, std::true_type) const;
+    template<typename K>
+    Node<Key, Value>* heterogeneousFind(const K& key, std::false_type) const;
+    // Cache slot for key, and removal of n from the cache
+    size_t cacheSlot(const Key& key) const;
+    void forgetNode(Node<Key, Value>* n);
+    // Empties every slot, for operations that hand nodes to another tree
+    void flushCache();
+
     // Helper function to delete a node
     // WARNING: MUST BE A LEAF NODE
     void removeNode(Node<Key, Value>* current);
@@ -289,6 +604,24 @@ protected:
 protected:
     Node<Key, Value>* root_;
     // You should not need other data members
+    size_t rotations_;
+    Compare comp_;
+    size_t tombstones_;     // dead nodes still linked into the tree
+    Node<Key, Value>* minNode_;     // smallest live node, NULL if none
+    Node<Key, Value>* maxNode_;     // largest live node, NULL if none
+    double scapegoatAlpha_;         // 0 unless scapegoat mode is on
+    size_t scapegoatSize_;          // node count, in scapegoat mode
+    size_t scapegoatPeak_;          // largest count since the last full rebuild
+    // Lookup cache slot: a node and its second-chance bit
+    struct CacheSlot
+    {
+        Node<Key, Value>* node;
+        bool referenced;
+    };
+    mutable std::vector<CacheSlot> cache_;  // lookup cache, empty if off
+    int cacheShift_;                // 64 - log2(cache_.size())
+    mutable size_t cacheHits_;
+    mutable size_t cacheMisses_;
 };
 
 /*
@@ -300,29 +633,41 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(Node<Key,Value> *ptr)
 {
     // TODO
     current_ = ptr;
+    skipDead_ = false;
+}
+
+/**
+* An iterator that steps over tombstones when skipDead is set
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(Node<Key,Value> *ptr, bool skipDead) :
+    current_(ptr), skipDead_(skipDead)
+{
+
 }
 
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator() 
 {
     // TODO
     current_ = NULL;
+    skipDead_ = false;
 }
 
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -330,9 +675,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -341,10 +686,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
     if (rhs.current_ == NULL && this->current_ == NULL) return true;
@@ -357,10 +702,10 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
     if (rhs.current_ == NULL && this->current_ == NULL) return false;
@@ -374,12 +719,15 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator++()
 {
     // TODO
     this->current_ = successor(this->current_);
+    while (skipDead_ && this->current_ != NULL && this->current_->isDead()) {
+        this->current_ = successor(this->current_);
+    }
     return *this;
 
 }
@@ -400,15 +748,65 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree() 
 {
     // TODO
     root_ = NULL;
+    rotations_ = 0;
+    tombstones_ = 0;
+    minNode_ = NULL;
+    maxNode_ = NULL;
+    scapegoatAlpha_ = 0;
+    scapegoatSize_ = 0;
+    scapegoatPeak_ = 0;
+    cacheShift_ = 0;
+    cacheHits_ = 0;
+    cacheMisses_ = 0;
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+/**
+* Creates an empty tree ordered by comp.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const Compare& comp) :
+    root_(NULL), rotations_(0), comp_(comp), tombstones_(0), minNode_(NULL), maxNode_(NULL),
+    scapegoatAlpha_(0), scapegoatSize_(0), scapegoatPeak_(0), cacheShift_(0), cacheHits_(0), cacheMisses_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(BinarySearchTree&& other) :
+    root_(other.root_), rotations_(other.rotations_), comp_(other.comp_), tombstones_(other.tombstones_),
+    minNode_(other.minNode_), maxNode_(other.maxNode_), scapegoatAlpha_(other.scapegoatAlpha_),
+    scapegoatSize_(other.scapegoatSize_), scapegoatPeak_(other.scapegoatPeak_), cache_(std::move(other.cache_)),
+    cacheShift_(other.cacheShift_), cacheHits_(other.cacheHits_), cacheMisses_(other.cacheMisses_)
+{
+    other.root_ = NULL;
+    other.tombstones_ = 0;
+    other.minNode_ = NULL;
+    other.maxNode_ = NULL;
+    other.scapegoatSize_ = 0;
+    other.scapegoatPeak_ = 0;
+    other.cache_.clear();
+}
+
+/**
+* Frees this tree's nodes, then takes other's. other ends up empty.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>& BinarySearchTree<Key, Value, Compare>::operator=(BinarySearchTree&& other)
+{
+    if (this != &other) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+template<typename Key, typename Value, typename Compare>
+BinarySearchTree<Key, Value, Compare>::~BinarySearchTree()
 {
     // TODO
     clear();
@@ -417,14 +815,156 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 /**
  * Returns true if tree is empty
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::empty() const
 {
-    return root_ == NULL;
+    // A tree holding only tombstones is empty too
+    return minNode_ == NULL;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+/**
+ * Returns a copy of the comparator that orders the keys
+*/
+template<class Key, class Value, class Compare>
+Compare BinarySearchTree<Key, Value, Compare>::key_comp() const
+{
+    return comp_;
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::swap(BinarySearchTree& other)
+{
+    std::swap(root_, other.root_);
+    std::swap(rotations_, other.rotations_);
+    std::swap(comp_, other.comp_);
+    std::swap(tombstones_, other.tombstones_);
+    std::swap(minNode_, other.minNode_);
+    std::swap(maxNode_, other.maxNode_);
+    std::swap(scapegoatAlpha_, other.scapegoatAlpha_);
+    std::swap(scapegoatSize_, other.scapegoatSize_);
+    std::swap(scapegoatPeak_, other.scapegoatPeak_);
+    cache_.swap(other.cache_);
+    std::swap(cacheShift_, other.cacheShift_);
+    std::swap(cacheHits_, other.cacheHits_);
+    std::swap(cacheMisses_, other.cacheMisses_);
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key, Value>& BinarySearchTree<Key, Value, Compare>::front() const
+{
+    if (minNode_ == NULL) throw std::out_of_range("Empty tree");
+    return minNode_->getItem();
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key, Value>& BinarySearchTree<Key, Value, Compare>::back() const
+{
+    if (maxNode_ == NULL) throw std::out_of_range("Empty tree");
+    return maxNode_->getItem();
+}
+
+/**
+* Erases the smallest item, if any, without a search. The next minimum is
+* one successor step away, which is O(1) amortized over a run of pops.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::pop_front()
+{
+    if (minNode_ != NULL) eraseNode(minNode_);
+}
+
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::countRange(const Key& lo, const Key& hi) const
+{
+    size_t count = 0;
+    for (Node<Key, Value>* n = lowerBoundNode(lo); n != NULL && compareKeys(n->getKey(), hi) < 0; n = successor(n)) {
+        if (!n->isDead()) ++count;
+    }
+    return count;
+}
+
+/**
+* eraseNode only frees the node it is given (a predecessor swap moves
+* nodes, it does not free them), so the next node stays valid.
+*/
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::eraseRange(const Key& lo, const Key& hi)
+{
+    size_t count = 0;
+    Node<Key, Value>* n = lowerBoundNode(lo);
+    while (n != NULL && compareKeys(n->getKey(), hi) < 0) {
+        Node<Key, Value>* next = successor(n);
+        if (!n->isDead()) {
+            eraseNode(n);
+            ++count;
+        }
+        n = next;
+    }
+    return count;
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::noteInserted(Node<Key, Value>* n)
+{
+    // Equal keys (multimaps) go after the existing copies, so only a
+    // strictly smaller key takes over the minimum
+    if (minNode_ == NULL || compareKeys(n->getKey(), minNode_->getKey()) < 0) minNode_ = n;
+    if (maxNode_ == NULL || compareKeys(n->getKey(), maxNode_->getKey()) >= 0) maxNode_ = n;
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::noteErasing(Node<Key, Value>* n)
+{
+    if (n == minNode_) {
+        do {
+            minNode_ = successor(minNode_);
+        } while (minNode_ != NULL && minNode_->isDead());
+    }
+    if (n == maxNode_) {
+        do {
+            maxNode_ = predecessor(maxNode_);
+        } while (maxNode_ != NULL && maxNode_->isDead());
+    }
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::resetEnds()
+{
+    minNode_ = findMin(root_);
+    while (minNode_ != NULL && minNode_->isDead()) minNode_ = successor(minNode_);
+    maxNode_ = findMax(root_);
+    while (maxNode_ != NULL && maxNode_->isDead()) maxNode_ = predecessor(maxNode_);
+}
+
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare> BinarySearchTree<Key, Value, Compare>::clone() const
+{
+    BinarySearchTree<Key, Value, Compare> copy(comp_);
+    copyInto(copy);
+    return copy;
+}
+
+template<class Key, class Value, class Compare>
+template<typename A, typename B>
+int BinarySearchTree<Key, Value, Compare>::compareKeys(const A& a, const B& b) const
+{
+    return KeyCompare<Key, Compare>::compare(comp_, a, b);
+}
+
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::rotationCount() const
+{
+    return rotations_;
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::resetRotationCount()
+{
+    rotations_ = 0;
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::print() const
 {
     printRoot(root_);
     std::cout << "\n";
@@ -433,53 +973,95 @@ void BinarySearchTree<Key, Value>::print() const
 /**
 * Returns an iterator to the "smallest" item in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
-    return begin;
+    return makeIterator(minNode_);
 }
 
 /**
 * Returns an iterator whose value means INVALID
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::end() const
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL);
+    BinarySearchTree<Key, Value, Compare>::iterator end(NULL);
     return end;
 }
 
+/**
+* Returns an iterator positioned at n (end() if n is NULL)
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::makeIterator(Node<Key, Value>* n) const
+{
+    return iterator(n, tombstones_ != 0);
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::iteratorNode(const iterator& it)
+{
+    return it.current_;
+}
+
 /**
 * Returns an iterator to the item with the given key, k
 * or the end iterator if k does not exist in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const Key & k) const
 {
-    Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
-    return it;
+    Node<Key, Value> *curr = cachedFind(k);
+    return makeIterator(curr);
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const K & k) const
+{
+    return makeIterator(heterogeneousFind(k, std::integral_constant<bool,
+        std::is_integral<K>::value && std::is_integral<Key>::value && LookupHash<Key, Compare>::enabled>()));
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than k,
+* or the end iterator if there is none
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const Key & k) const
+{
+    return makeIterator(lowerBoundNode(k));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const K & k) const
+{
+    return makeIterator(lowerBoundNode(k));
 }
 
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
  */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+template<class Key, class Value, class Compare>
+Value& BinarySearchTree<Key, Value, Compare>::operator[](const Key& key)
 {
-    Node<Key, Value> *curr = internalFind(key);
+    Node<Key, Value> *curr = cachedFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+template<class Key, class Value, class Compare>
+Value const & BinarySearchTree<Key, Value, Compare>::operator[](const Key& key) const
 {
-    Node<Key, Value> *curr = internalFind(key);
+    Node<Key, Value> *curr = cachedFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
@@ -490,32 +1072,39 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 * Recall: If key is already in the tree, you should 
 * overwrite the current value with the updated value.
 */
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
     // TODO
+    if (scapegoatAlpha_ != 0) {
+        scapegoatInsert(keyValuePair);
+        return;
+    }
     // Create new Node, then call helper function to insert into tree
     Node<Key, Value>* myNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
     if (root_ == NULL) {
         root_ = myNode;
     } else {
-        insertHelper(root_, myNode);
+        myNode = insertHelper(root_, myNode);
     }
+    noteInserted(myNode);
     return;
 }
 
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insertHelper(Node<Key, Value>* current, Node<Key, Value>* newNode)
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::insertHelper(Node<Key, Value>* current, Node<Key, Value>* newNode)
 {
+    int c = compareKeys(newNode->getKey(), current->getKey());
+
     /**
      * Base case: key is found in tree
      * 
      * Desired action: Replace current value with new value
     */
-    if (newNode->getKey() == current->getKey()) {
+    if (c == 0) {
         current->setValue(newNode->getValue());
         delete newNode;
-        return;
+        return current;
     }
     /**
      * Recursive case: newNode key is less than current node's key
@@ -524,14 +1113,13 @@ void BinarySearchTree<Key, Value>::insertHelper(Node<Key, Value>* current, Node<
      *  If left child exists, recurse.
      *  Else, set newNode as left child of current
     */
-    if (newNode->getKey() < current->getKey()) {
+    if (c < 0) {
         if (current->getLeft() != NULL) {
-            insertHelper(current->getLeft(), newNode);
-            return;
+            return insertHelper(current->getLeft(), newNode);
         } else {
             newNode->setParent(current);
             current->setLeft(newNode);
-            return;
+            return newNode;
         }
     }
     /**
@@ -541,13 +1129,13 @@ void BinarySearchTree<Key, Value>::insertHelper(Node<Key, Value>* current, Node<
      *  If right child exists, recurse.
      *  Else, set newNode as right child of current
     */
-    else if (newNode->getKey() > current->getKey()) {
+    else {
         if (current->getRight() != NULL) {
-            insertHelper(current->getRight(), newNode);
-            return;
+            return insertHelper(current->getRight(), newNode);
         } else {
             newNode->setParent(current);
             current->setRight(newNode);
+            return newNode;
         }
     }
 }
@@ -558,97 +1146,60 @@ void BinarySearchTree<Key, Value>::insertHelper(Node<Key, Value>* current, Node<
 * Recall: The writeup specifies that if a node has 2 children you
 * should swap with the predecessor and then remove.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::remove(const Key& key)
 {
     // TODO
-    removeHelper(root_, key);
+    Node<Key, Value>* current = internalFind(key);
+    if (current != NULL) eraseNode(current);
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::removeHelper(Node<Key, Value>* current, const Key& key)
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+void BinarySearchTree<Key, Value, Compare>::remove(const K& key)
 {
-    /**
-     * Base case: current node is null
-     * 
-     * Desired action: return
-    */
-    if (current == NULL) return;
+    Node<Key, Value>* current = findNode(key);
+    if (current != NULL) eraseNode(current);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* current)
+{
+    noteErasing(current);
 
     /**
-     * Base case: current node is to be removed
-     * 
-     * Desired action:
-     *  If two children, swap with predecessor and remove
-     *  If one child, promote child and remove
-     *  If no children, remove
+     * If two children, swap with predecessor, which leaves current
+     * with at most one child (nodeSwap also updates root_)
     */
-    if (current->getKey() == key) {
-        // No children case
-        if (current->getRight() == NULL && current->getLeft() == NULL) {
-            removeNode(current);
-        }
-
-        // Two children case
+    if (current->getRight() != NULL && current->getLeft() != NULL) {
+        nodeSwap(current, predecessor(current));
+    }
 
-        else if (current->getRight() != NULL && current->getLeft() != NULL) {
-            Node<Key, Value>* n = predecessor(current);
-            nodeSwap(current, n);
-            if (root_ == current) {
-                root_ = n;
-            }
-            // Since current may still have two children, we recurse until
-            // It either has one child or none, where it will be eventually removed
-            removeHelper(current, key);
-        }
+    // No children case
+    if (current->getRight() == NULL && current->getLeft() == NULL) {
+        removeNode(current);
+    }
+    // One child case: promote the child into current's place
+    else if (current->getLeft() != NULL) {
+        promoteNode(current, current->getParent(), current->getLeft());
+    } else {
+        promoteNode(current, current->getParent(), current->getRight());
+    }
 
-        // One child case
-
-        /**
-         * WARNING: THIS CASE CAUSES BLOOD AND TEARS
-        */
-        else {
-            // Determine which child exists, then promote child
-
-            // If current has a left child     
-            if (current->getLeft() != NULL) {
-
-                // If root is to be removed
-                if (root_ == current) {
-                    promoteNode(current, NULL, current->getLeft());
-                } else {
-                    promoteNode(current, current->getParent(), current->getLeft());
-                }
-            // If current has a right child
-            } else {
-                // If root is to be removed
-                if (root_ == current) {
-                    promoteNode(current, NULL, current->getRight());
-                } else {
-                    promoteNode(current, current->getParent(), current->getRight());
-                }
-            }
+    if (scapegoatAlpha_ != 0) {
+        --scapegoatSize_;
+        if (scapegoatSize_ < scapegoatAlpha_ * scapegoatPeak_) {
+            if (root_ != NULL) rebuildSubtree(root_, scapegoatSize_);
+            scapegoatPeak_ = scapegoatSize_;
         }
     }
-    /**
-     * Recursive case: Current node is not to be removed
-     * 
-     * Desired action: Recurse in the appropriate direction
-    */
-    else if (key > current->getKey()) {
-        removeHelper(current->getRight(), key);
-    } 
-    else if (key < current->getKey()) {
-        removeHelper(current->getLeft(), key);
-    }
-    return;
 }
 
 
 
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare>::predecessor(Node<Key, Value>* current)
 {
     // TODO
     if (current == NULL) return NULL;
@@ -667,8 +1218,8 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
     return p;
 }
 
-template<class Key, class Value>
-Node<Key, Value>* BinarySearchTree<Key,Value>::successor(Node<Key, Value>* current)
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::successor(Node<Key, Value>* current)
 {
     // TODO
     if (current == NULL) return NULL;
@@ -688,26 +1239,22 @@ Node<Key, Value>* BinarySearchTree<Key,Value>::successor(Node<Key, Value>* curre
 
 }
 
-template<class Key, class Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::findMin(Node<Key, Value>* current)
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findMin(Node<Key, Value>* current)
 {
     // TODO
     if (current == NULL) return NULL;
-    if (current->getLeft() != NULL) {
-        return findMin(current->getLeft());
-    }
+    while (current->getLeft() != NULL) current = current->getLeft();
     return current;
 
 }
 
-template<class Key, class Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::findMax(Node<Key, Value>* current)
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findMax(Node<Key, Value>* current)
 {
     // TODO
     if (current == NULL) return NULL;
-    if (current->getRight() != NULL) {
-        return findMax(current->getRight());
-    }
+    while (current->getRight() != NULL) current = current->getRight();
     return current;
 
 }
@@ -716,16 +1263,356 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::findMax(Node<Key, Value>* curren
 * A method to remove all contents of the tree and
 * reset the values in the tree for use again.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clear()
 {
     // TODO
     clearHelper(root_);
+    root_ = NULL;
+    tombstones_ = 0;
+    minNode_ = NULL;
+    maxNode_ = NULL;
+    scapegoatSize_ = 0;
+    scapegoatPeak_ = 0;
+    flushCache();
 
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::promoteNode(Node<Key, Value>* current, Node<Key, Value>* parent, Node<Key, Value>* child)
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::leftRotate(Node<Key, Value>* current, Node<Key, Value>* rChild)
+{
+    ++rotations_;
+
+    // Handles movement of rChild's left child
+    if (rChild->getLeft() != NULL) {
+        current->setRight(rChild->getLeft());
+        rChild->getLeft()->setParent(current);
+    } else {
+        current->setRight(NULL);
+    }
+
+    // Handles if current is root (i.e. has no parent)
+    if (current->getParent() == NULL) {
+        root_ = rChild;
+        rChild->setParent(NULL);
+
+    // If current is a left child   
+    } else if (current->getParent()->getLeft() == current) {
+        current->getParent()->setLeft(rChild);
+        rChild->setParent(current->getParent());
+
+    // If current is a right child
+    } else if (current->getParent()->getRight() == current) {
+        current->getParent()->setRight(rChild);
+        rChild->setParent(current->getParent());
+    }
+
+    // Set rChild as parent of current, completing rotation
+    current->setParent(rChild);
+    rChild->setLeft(current);
+    rotated(current, rChild);
+    return;
+
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::rightRotate(Node<Key, Value>* current, Node<Key, Value>* lChild)
+{
+    ++rotations_;
+
+    // Handles movement of lChild's right child
+    if (lChild->getRight() != NULL) {
+        current->setLeft(lChild->getRight());
+        lChild->getRight()->setParent(current);
+    } else {
+        current->setLeft(NULL);
+    }
+
+    // Handles if current is root (i.e. has no parent)
+    if (current->getParent() == NULL) {
+        root_ = lChild;
+        lChild->setParent(NULL);
+    }
+
+    // If current is a left child   
+    else if (current->getParent()->getLeft() == current) {
+        current->getParent()->setLeft(lChild);
+        lChild->setParent(current->getParent());
+
+    // If current is a right child
+    } else if (current->getParent()->getRight() == current) {
+        current->getParent()->setRight(lChild);
+        lChild->setParent(current->getParent());
+    }
+
+    // Set lChild as parent of current, completing rotation
+    current->setParent(lChild);
+    lChild->setRight(current);
+    rotated(current, lChild);
+    return;
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::rotated(Node<Key, Value>*, Node<Key, Value>*)
+{
+
+}
+
+/**
+* Takes the middle node as the root (the upper middle for even counts), so
+* the two halves differ in size by at most one and in height by at most
+* one. Recursion depth is O(log n).
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::linkBalanced(
+    const std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi, Node<Key, Value>* parent, int& height)
+{
+    if (lo >= hi) {
+        height = 0;
+        return NULL;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    Node<Key, Value>* n = nodes[mid];
+    int leftHeight, rightHeight;
+    n->setParent(parent);
+    n->setLeft(linkBalanced(nodes, lo, mid, n, leftHeight));
+    n->setRight(linkBalanced(nodes, mid + 1, hi, n, rightHeight));
+    height = 1 + std::max(leftHeight, rightHeight);
+    relinked(n, leftHeight, rightHeight);
+    return n;
+}
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::relinked(Node<Key, Value>*, int, int)
+{
+
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::setScapegoat(double alpha)
+{
+    scapegoatAlpha_ = alpha;
+    if (alpha == 0) return;
+    scapegoatSize_ = countNodes(root_);
+    scapegoatPeak_ = scapegoatSize_;
+    if (root_ != NULL) rebuildSubtree(root_, scapegoatSize_);
+}
+
+template<typename Key, typename Value, typename Compare>
+double BinarySearchTree<Key, Value, Compare>::scapegoat() const
+{
+    return scapegoatAlpha_;
+}
+
+/**
+* The depth bound log_{1/alpha}(n) is what a tree in alpha-weight balance
+* can reach, so a deeper node has an ancestor out of balance. Climbing
+* from the new node, each step sizes the sibling subtree; the sizes add up
+* to the scapegoat's, which the rebuild costs anyway.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::scapegoatInsert(const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* parent = NULL;
+    Node<Key, Value>* current = root_;
+    int c = 0;
+    size_t depth = 0;
+    while (current != NULL) {
+        c = compareKeys(keyValuePair.first, current->getKey());
+        if (c == 0) {
+            current->setValue(keyValuePair.second);
+            return;
+        }
+        parent = current;
+        current = (c < 0) ? current->getLeft() : current->getRight();
+        ++depth;
+    }
+
+    Node<Key, Value>* myNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+    if (parent == NULL) {
+        root_ = myNode;
+    } else if (c < 0) {
+        parent->setLeft(myNode);
+    } else {
+        parent->setRight(myNode);
+    }
+    noteInserted(myNode);
+    ++scapegoatSize_;
+    scapegoatPeak_ = std::max(scapegoatPeak_, scapegoatSize_);
+
+    if (depth <= std::log(static_cast<double>(scapegoatSize_)) / -std::log(scapegoatAlpha_)) return;
+
+    Node<Key, Value>* child = myNode;
+    size_t childSize = 1;
+    while (child->getParent() != NULL) {
+        Node<Key, Value>* up = child->getParent();
+        Node<Key, Value>* sibling = (up->getLeft() == child) ? up->getRight() : up->getLeft();
+        size_t upSize = childSize + countNodes(sibling) + 1;
+        if (childSize > scapegoatAlpha_ * upSize) {
+            rebuildSubtree(up, upSize);
+            return;
+        }
+        child = up;
+        childSize = upSize;
+    }
+}
+
+/**
+* Collects the nodes in order with successor(), stopping after count so the
+* walk never leaves the subtree, and hands them to linkBalanced. The same
+* nodes stay in the tree, so minNode_ and maxNode_ remain valid.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rebuildSubtree(Node<Key, Value>* top, size_t count)
+{
+    Node<Key, Value>* parent = top->getParent();
+    bool wasLeft = (parent != NULL && parent->getLeft() == top);
+
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(count);
+    Node<Key, Value>* current = findMin(top);
+    for (size_t i = 0; i < count; ++i) {
+        nodes.push_back(current);
+        current = successor(current);
+    }
+
+    int height;
+    Node<Key, Value>* rebuilt = linkBalanced(nodes, 0, count, parent, height);
+    if (parent == NULL) {
+        root_ = rebuilt;
+    } else if (wasLeft) {
+        parent->setLeft(rebuilt);
+    } else {
+        parent->setRight(rebuilt);
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::countNodes(Node<Key, Value>* root)
+{
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> pending;
+    if (root != NULL) pending.push_back(root);
+    while (!pending.empty()) {
+        Node<Key, Value>* n = pending.back();
+        pending.pop_back();
+        ++count;
+        if (n->getLeft() != NULL) pending.push_back(n->getLeft());
+        if (n->getRight() != NULL) pending.push_back(n->getRight());
+    }
+    return count;
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::setLookupCache(size_t slots)
+{
+    cache_.clear();
+    cacheShift_ = 0;
+    if (slots == 0 || !LookupHash<Key, Compare>::enabled) return;
+    int bits = 1;
+    while ((size_t(1) << bits) < slots && bits < 62) ++bits;
+    CacheSlot empty = { NULL, false };
+    cache_.assign(size_t(1) << bits, empty);
+    cacheShift_ = 64 - bits;
+}
+
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::cacheHits() const
+{
+    return cacheHits_;
+}
+
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::cacheMisses() const
+{
+    return cacheMisses_;
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::resetCacheStats()
+{
+    cacheHits_ = 0;
+    cacheMisses_ = 0;
+}
+
+/**
+* A slot holds one node for the keys mapping to it. Replacement gives the
+* occupant a second chance, as CLOCK does: a hit marks it referenced, and
+* a miss only clears the mark, taking the slot on the next miss. A key
+* that keeps being asked for thus survives the cold keys colliding with
+* it. Tombstones stay cached until they are freed, so a hit must also be
+* live.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::cachedFind(const Key& key) const
+{
+    if (cache_.empty()) return internalFind(key);
+
+    CacheSlot& slot = cache_[cacheSlot(key)];
+    if (slot.node != NULL && compareKeys(key, slot.node->getKey()) == 0 && !slot.node->isDead()) {
+        ++cacheHits_;
+        slot.referenced = true;
+        return slot.node;
+    }
+    ++cacheMisses_;
+    Node<Key, Value>* n = internalFind(key);
+    if (n != NULL) {
+        if (slot.referenced) {
+            slot.referenced = false;
+        } else {
+            slot.node = n;
+        }
+    }
+    return n;
+}
+
+/**
+* Converting changes neither the key's value nor its sign only when it
+* round-trips, and only then does the converted Key compare like key.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::heterogeneousFind(const K& key, std::true_type) const
+{
+    Key converted = static_cast<Key>(key);
+    if (static_cast<K>(converted) == key && (converted < Key()) == (key < K())) return cachedFind(converted);
+    return findNode(key);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::heterogeneousFind(const K& key, std::false_type) const
+{
+    return findNode(key);
+}
+
+// Fibonacci hashing: the top bits of the product mix every bit of the hash
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::cacheSlot(const Key& key) const
+{
+    return static_cast<size_t>((LookupHash<Key, Compare>::hash(key) * 0x9E3779B97F4A7C15ULL) >> cacheShift_);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::forgetNode(Node<Key, Value>* n)
+{
+    if (cache_.empty()) return;
+    CacheSlot& slot = cache_[cacheSlot(n->getKey())];
+    if (slot.node == n) {
+        slot.node = NULL;
+        slot.referenced = false;
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::flushCache()
+{
+    CacheSlot empty = { NULL, false };
+    std::fill(cache_.begin(), cache_.end(), empty);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::promoteNode(Node<Key, Value>* current, Node<Key, Value>* parent, Node<Key, Value>* child)
 {
     // If root is to be removed and there exists a, promote child
     if (parent == NULL) {
@@ -733,7 +1620,7 @@ void BinarySearchTree<Key, Value>::promoteNode(Node<Key, Value>* current, Node<K
         // Move root_ pointer, set new root_'s parent to NULL, delete current
         root_ = child;
         child->setParent(NULL);
-        delete current;
+        destroyNode(current);
 
     } else {
         // Set current's child's parent to current's parent
@@ -751,7 +1638,7 @@ void BinarySearchTree<Key, Value>::promoteNode(Node<Key, Value>* current, Node<K
             // Set child of current's parent to current's child
             parent->setRight(child);
         }
-        delete current;
+        destroyNode(current);
     }
     return;
 }
@@ -759,8 +1646,8 @@ void BinarySearchTree<Key, Value>::promoteNode(Node<Key, Value>* current, Node<K
 /**
  * WARNING: MUST BE A LEAF NODE
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* current)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::removeNode(Node<Key, Value>* current)
 {
     // If current is null
     if (current == NULL) return;
@@ -780,26 +1667,128 @@ void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* current)
     current->setLeft(NULL);
     current->setRight(NULL);
     current->setParent(NULL);
-    delete current;
+    destroyNode(current);
     return;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clearHelper(Node<Key, Value>* current)
+template<typename Key, typename Value, typename Compare>
+template<typename Pool>
+void BinarySearchTree<Key, Value, Compare>::clearInBackground(Pool& pool)
 {
-    if (current == NULL) return;
-    clearHelper(current->getLeft());
-    clearHelper(current->getRight());
-    removeNode(current);
+    std::function<void()> task = detachNodes();
+    if (task) pool.submit(task);
+}
+
+template<typename Key, typename Value, typename Compare>
+std::function<void()> BinarySearchTree<Key, Value, Compare>::detachNodes()
+{
+    Node<Key, Value>* old = root_;
+    root_ = NULL;
+    // Resets whatever else the tree (or a subclass) keeps
+    clear();
+    if (old == NULL) return std::function<void()>();
+    return [old]() {
+        freeSubtree(old, [](Node<Key, Value>* n) { delete n; });
+    };
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clearHelper(Node<Key, Value>* current)
+{
+    // clear() flushes the whole cache afterwards, so no per-node forgetNode
+    freeSubtree(current, [this](Node<Key, Value>* n) { releaseNode(n); });
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename Free>
+void BinarySearchTree<Key, Value, Compare>::freeSubtree(Node<Key, Value>* root, Free release)
+{
+    if (root == NULL) return;
+
+    // Pre-order: a node's children are read and stacked before it is
+    // freed, so each node is visited once. The stack holds at most one
+    // pending right child per level.
+    std::vector<Node<Key, Value>*> pending;
+    Node<Key, Value>* current = root;
+    while (true) {
+        Node<Key, Value>* left = current->getLeft();
+        Node<Key, Value>* right = current->getRight();
+        release(current);
+        if (left != NULL) {
+            if (right != NULL) pending.push_back(right);
+            current = left;
+        } else if (right != NULL) {
+            current = right;
+        } else if (!pending.empty()) {
+            current = pending.back();
+            pending.pop_back();
+        } else {
+            return;
+        }
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::destroyNode(Node<Key, Value>* n)
+{
+    forgetNode(n);
+    releaseNode(n);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::releaseNode(Node<Key, Value>* n)
+{
+    delete n;
+}
+
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const
+{
+    return new Node<Key, Value>(n->getKey(), n->getValue(), parent);
+}
+
+/**
+* Pre-order with an explicit stack of (original, copy) pairs whose
+* children still need copying, so any depth is fine.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::copyInto(BinarySearchTree& copy) const
+{
+    if (root_ == NULL) return;
+
+    std::vector<std::pair<const Node<Key, Value>*, Node<Key, Value>*> > pending;
+    copy.root_ = copyNode(root_, NULL);
+    pending.push_back(std::make_pair(root_, copy.root_));
+    while (!pending.empty()) {
+        const Node<Key, Value>* from = pending.back().first;
+        Node<Key, Value>* to = pending.back().second;
+        pending.pop_back();
+        if (from->getLeft() != NULL) {
+            to->setLeft(copyNode(from->getLeft(), to));
+            pending.push_back(std::make_pair(from->getLeft(), to->getLeft()));
+        }
+        if (from->getRight() != NULL) {
+            to->setRight(copyNode(from->getRight(), to));
+            pending.push_back(std::make_pair(from->getRight(), to->getRight()));
+        }
+    }
+    copy.tombstones_ = tombstones_;
+    copy.scapegoatAlpha_ = scapegoatAlpha_;
+    copy.scapegoatSize_ = scapegoatSize_;
+    copy.scapegoatPeak_ = scapegoatPeak_;
+    CacheSlot empty = { NULL, false };
+    copy.cache_.assign(cache_.size(), empty);
+    copy.cacheShift_ = cacheShift_;
+    copy.resetEnds();
 }
 
 
 /**
 * A helper function to find the smallest node in the tree.
 */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNode() const
+BinarySearchTree<Key, Value, Compare>::getSmallestNode() const
 {
     // TODO
     return findMin(root_);
@@ -810,79 +1799,141 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::internalFind(const Key& key) const
 {
     // TODO
-    return findHelper(root_, key);
+    return findNode(key);
 }
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::findHelper(Node<Key, Value>* current, const Key& key) const
+/**
+* Iterative lookup with one three-way comparison per level. key may be
+* of any type compareKeys accepts alongside Key.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findNode(const K& key) const
 {
-    /**
-     * Base case: current node is null
-     * 
-     * Desired action: return null
-    */
-    if (current == NULL) return NULL;
-
-    /**
-     * Base case: current node key matches key
-     * 
-     * Desired action: return current
-    */
-    if (current->getKey() == key) {
-        return current;
+    Node<Key, Value>* current = root_;
+    while (current != NULL) {
+        int c = compareKeys(key, current->getKey());
+        if (c < 0) {
+            current = current->getLeft();
+        } else if (c > 0) {
+            current = current->getRight();
+        } else {
+            // Keys are unique, so a tombstone means the key is absent
+            if (tombstones_ != 0 && current->isDead()) return NULL;
+            return current;
+        }
     }
-   /**
-    * Recursive case: current node key ≠ key
-    * 
-    * Desired action: recurse in appropriate direction
-   */
-    else if (key > current->getKey()) {
-        return findHelper(current->getRight(), key);
+    return NULL;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::lowerBoundNode(const K& key) const
+{
+    Node<Key, Value>* candidate = NULL;
+    Node<Key, Value>* current = root_;
+    while (current != NULL) {
+        if (compareKeys(current->getKey(), key) < 0) {
+            current = current->getRight();
+        } else {
+            candidate = current;
+            current = current->getLeft();
+        }
     }
-    else {
-        return findHelper(current->getLeft(), key);
+    if (tombstones_ != 0) {
+        while (candidate != NULL && candidate->isDead()) candidate = successor(candidate);
     }
+    return candidate;
 }
 
 /**
  * Return true iff the BST is balanced.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isBalanced() const
 {
     // TODO
-    if (root_ == NULL) return true;
-
-    return ((std::abs(findHeight(root_->getLeft(), 1) - findHeight(root_->getRight(), 1)) <= 1) && balancedHelper(root_->getLeft(), 1) && balancedHelper(root_->getRight(), 1));
+    bool balanced = true;
+    heightAndBalance(root_, balanced, true);
+    return balanced;
 }
 
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::balancedHelper(Node<Key, Value>* current, int length) const
+/**
+ * Returns the number of nodes on the longest root-to-leaf path
+ * (0 for an empty tree).
+ */
+template<typename Key, typename Value, typename Compare>
+int BinarySearchTree<Key, Value, Compare>::height() const
 {
-    if (current == NULL) return true;
-    return (std::abs(findHeight(current->getLeft(), length + 1) - findHeight(current->getRight(), length + 1)) <= 1 && balancedHelper(current->getLeft(), length + 1) && balancedHelper(current->getRight(), length + 1));
+    bool balanced = true;
+    return heightAndBalance(root_, balanced, false);
 }
 
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::findHeight(Node<Key, Value>* current, int height) const
+template<typename Key, typename Value, typename Compare>
+int BinarySearchTree<Key, Value, Compare>::heightAndBalance(Node<Key, Value>* current, bool& balanced, bool stopEarly)
 {
     /**
-     * Almost same implementation of checkPathLength in equal-paths
+     * Iterative post-order walk using parent pointers, so degenerate trees
+     * cannot overflow the call stack. Heights of finished subtrees are kept
+     * on an explicit stack: a node pops its two children's heights and
+     * pushes its own.
     */
     if (current == NULL) return 0;
-    
-    if (current->getRight() == NULL && current->getLeft() == NULL) return height;
 
-    return std::max(findHeight(current->getLeft(), height+1), findHeight(current->getRight(), height+1));
+    Node<Key, Value>* const root = current;
+    Node<Key, Value>* prev = root->getParent();
+    std::vector<int> heights;
+
+    while (current != NULL) {
+        Node<Key, Value>* left = current->getLeft();
+        Node<Key, Value>* right = current->getRight();
+
+        // Arrived from above: visit left subtree, or record an empty one
+        if (prev == current->getParent()) {
+            if (left != NULL) {
+                prev = current;
+                current = left;
+                continue;
+            }
+            heights.push_back(0);
+            prev = left;
+        }
+
+        // Returned from the left subtree: visit right subtree, or record an empty one
+        if (prev == left) {
+            if (right != NULL) {
+                prev = current;
+                current = right;
+                continue;
+            }
+            heights.push_back(0);
+        }
+
+        // Both subtrees done: combine their heights
+        int rightHeight = heights.back();
+        heights.pop_back();
+        int leftHeight = heights.back();
+        heights.pop_back();
+
+        if (std::abs(leftHeight - rightHeight) > 1) {
+            balanced = false;
+            if (stopEarly) return 0;
+        }
+        heights.push_back(std::max(leftHeight, rightHeight) + 1);
+
+        prev = current;
+        current = (current == root) ? NULL : current->getParent();
+    }
+    return heights.back();
 }
 
 
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
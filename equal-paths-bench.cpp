@@ -0,0 +1,292 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+
+using namespace std;
+
+/**
+ * Benchmark for equalPaths on trees of the Node struct from equal-paths.h.
+ *
+ * Shapes (n is rounded down to 2^k - 1 for the perfect-tree shapes):
+ *  balanced:    perfect tree; every leaf matches, so the whole tree is walked
+ *  skewed:      a single left-leaning path of n nodes
+ *  zigzag:      a single path alternating left and right children
+ *  adversarial: perfect tree plus one extra leaf under the last leaf, so
+ *               the mismatch is only found at the very end
+ *  early-exit:  perfect tree plus one extra leaf under the first leaf, so
+ *               the second leaf visited already mismatches
+ *  forest:      perfect trees of 127 nodes each, n nodes in total
+ *
+ * Each shape is also timed with the earlier recursive two-pass version
+ * ("recursive") where its recursion depth is small enough to be safe;
+ * the path shapes are recorded as skipped for it above --recursion-cap.
+ *
+ * For scaling, the perfect-tree shapes and the forest are also timed with
+ * parallelEqualPaths on pools of each size in --threads (default 1,2,4,8),
+ * reported as "parallel-<threads>". The sequential forest run calls
+ * equalPaths once per tree.
+ *
+ * Usage: equal-paths-bench [--min-size N] [--max-size N] [--recursion-cap N]
+ *                          [--threads a,b,...] [--out FILE]
+ *
+ * Sizes run in powers of ten from --min-size (default 1e3) up to
+ * --max-size (default 1e6). Results are written as JSON.
+ */
+
+// Total number of nodes each measurement should visit at least
+static const size_t MIN_NODES_PER_SAMPLE = 10000000;
+
+// Nodes in each tree of the forest shape (a perfect tree of depth 6)
+static const size_t FOREST_TREE_SIZE = 127;
+
+enum Shape { BALANCED, SKEWED, ZIGZAG, ADVERSARIAL, EARLY_EXIT, FOREST };
+
+static const char* const SHAPE_NAMES[] = { "balanced", "skewed", "zigzag", "adversarial", "early-exit", "forest" };
+
+// The recursive two-pass implementation equalPaths replaced, as a baseline
+static int recursiveBaseLength(Node* root, int length)
+{
+    if (root->left == NULL && root->right == NULL) return length;
+    return recursiveBaseLength(root->left != NULL ? root->left : root->right, length + 1);
+}
+
+static bool recursiveCheck(Node* root, int length, int baseLength)
+{
+    if (root == NULL) return true;
+    if (root->left == NULL && root->right == NULL) return length == baseLength;
+    return recursiveCheck(root->left, length + 1, baseLength) && recursiveCheck(root->right, length + 1, baseLength);
+}
+
+static bool recursiveEqualPaths(Node* root)
+{
+    if (root == NULL) return true;
+    return recursiveCheck(root, 0, recursiveBaseLength(root, 0));
+}
+
+/**
+ * Builds a tree of the given shape with about n nodes and returns its
+ * nodes; the root is element 0. Built without recursion, since path
+ * shapes are as deep as they are large. The forest is built separately.
+ */
+static vector<Node*> buildTree(Shape shape, size_t n)
+{
+    vector<Node*> nodes;
+    if (shape == SKEWED || shape == ZIGZAG) {
+        nodes.reserve(n);
+        nodes.push_back(new Node(0));
+        for (size_t i = 1; i < n; ++i) {
+            Node* child = new Node((int)i);
+            if (shape == SKEWED || i % 2 == 0) nodes.back()->left = child;
+            else nodes.back()->right = child;
+            nodes.push_back(child);
+        }
+        return nodes;
+    }
+
+    // Perfect tree in heap layout: node i has children 2i+1 and 2i+2
+    size_t perfect = 1;
+    while (perfect * 2 + 1 <= n) perfect = perfect * 2 + 1;
+    nodes.reserve(perfect + 1);
+    for (size_t i = 0; i < perfect; ++i) nodes.push_back(new Node((int)i));
+    for (size_t i = 0; 2 * i + 2 < perfect; ++i) {
+        nodes[i]->left = nodes[2 * i + 1];
+        nodes[i]->right = nodes[2 * i + 2];
+    }
+
+    // Leaves are the second half; the first and last are the leftmost
+    // and rightmost in the order equalPaths visits them
+    if (shape == ADVERSARIAL || shape == EARLY_EXIT) {
+        Node* leaf = (shape == ADVERSARIAL) ? nodes[perfect - 1] : nodes[perfect / 2];
+        leaf->left = new Node((int)perfect);
+        nodes.push_back(leaf->left);
+    }
+    return nodes;
+}
+
+static void freeTree(vector<Node*>& nodes)
+{
+    for (size_t i = 0; i < nodes.size(); ++i) delete nodes[i];
+    nodes.clear();
+}
+
+// Builds n / FOREST_TREE_SIZE (at least one) perfect trees into nodes and
+// returns their roots
+static vector<Node*> buildForest(size_t n, vector<Node*>& nodes)
+{
+    vector<Node*> roots;
+    for (size_t built = 0; built == 0 || built + FOREST_TREE_SIZE <= n; built += FOREST_TREE_SIZE) {
+        vector<Node*> tree = buildTree(BALANCED, FOREST_TREE_SIZE);
+        roots.push_back(tree[0]);
+        nodes.insert(nodes.end(), tree.begin(), tree.end());
+    }
+    return roots;
+}
+
+struct BenchResult
+{
+    string impl;
+    string shape;
+    size_t nodes;
+    bool result;
+    double nsPerCall;
+    double nsPerNode;
+    string skipped;
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Keeps results observable so calls are not optimized away
+static size_t g_sink = 0;
+
+// Fn takes the root and returns the equalPaths answer; for the forest it
+// checks every tree and returns whether all of them have equal paths
+template<class Fn>
+static BenchResult timeCalls(const string& impl, Shape shape, vector<Node*>& nodes, Fn fn)
+{
+    size_t reps = std::max<size_t>(1, MIN_NODES_PER_SAMPLE / nodes.size());
+    bool result = false;
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t r = 0; r < reps; ++r) {
+        result = fn(nodes[0]);
+        g_sink += result;
+    }
+    double total = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+
+    BenchResult res;
+    res.impl = impl;
+    res.shape = SHAPE_NAMES[shape];
+    res.nodes = nodes.size();
+    res.result = result;
+    res.nsPerCall = total / reps;
+    res.nsPerNode = res.nsPerCall / nodes.size();
+    return res;
+}
+
+static void writeJson(ostream& os, const vector<BenchResult>& results)
+{
+    os << "{\n";
+    os << "  \"benchmark\": \"equal-paths-bench\",\n";
+    os << "  \"version\": 1,\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        os << "    {\"impl\": \"" << r.impl << "\", \"shape\": \"" << r.shape << "\", \"nodes\": " << r.nodes;
+        if (!r.skipped.empty()) {
+            os << ", \"skipped\": \"" << r.skipped << "\"}";
+        } else {
+            os << ", \"result\": " << (r.result ? "true" : "false") << ", \"ns_per_call\": " << r.nsPerCall
+               << ", \"ns_per_node\": " << r.nsPerNode << "}";
+        }
+        os << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    size_t minSize = 1000;
+    size_t maxSize = 1000000;
+    size_t recursionCap = 10000;
+    vector<unsigned> threadCounts;
+    threadCounts.push_back(1);
+    threadCounts.push_back(2);
+    threadCounts.push_back(4);
+    threadCounts.push_back(8);
+    string out;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return 1;
+        }
+        string val = argv[++i];
+        if (arg == "--min-size") minSize = (size_t)atof(val.c_str());
+        else if (arg == "--max-size") maxSize = (size_t)atof(val.c_str());
+        else if (arg == "--recursion-cap") recursionCap = (size_t)atof(val.c_str());
+        else if (arg == "--threads") {
+            threadCounts.clear();
+            stringstream ss(val);
+            string part;
+            while (std::getline(ss, part, ',')) {
+                if (!part.empty()) threadCounts.push_back((unsigned)atoi(part.c_str()));
+            }
+        }
+        else if (arg == "--out") out = val;
+        else {
+            cerr << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    if (minSize < 1) minSize = 1;
+
+    vector<ThreadPool*> pools;
+    for (size_t t = 0; t < threadCounts.size(); ++t) pools.push_back(new ThreadPool(threadCounts[t]));
+
+    vector<BenchResult> results;
+    for (size_t n = minSize; n <= maxSize; n *= 10) {
+        for (int s = BALANCED; s <= EARLY_EXIT; ++s) {
+            Shape shape = (Shape)s;
+            cerr << "n=" << n << " shape=" << SHAPE_NAMES[s] << endl;
+            vector<Node*> nodes = buildTree(shape, n);
+            results.push_back(timeCalls("iterative", shape, nodes, equalPaths));
+            if (shape == BALANCED || shape == ADVERSARIAL) {
+                for (size_t t = 0; t < pools.size(); ++t) {
+                    ThreadPool* pool = pools[t];
+                    results.push_back(timeCalls("parallel-" + std::to_string(pool->size()), shape, nodes,
+                                                [pool](Node* root) { return parallelEqualPaths(root, *pool); }));
+                }
+            }
+
+            bool deep = (shape == SKEWED || shape == ZIGZAG);
+            if (deep && nodes.size() > recursionCap) {
+                BenchResult res;
+                res.impl = "recursive";
+                res.shape = SHAPE_NAMES[s];
+                res.nodes = nodes.size();
+                res.skipped = "recursion depth";
+                results.push_back(res);
+            } else {
+                results.push_back(timeCalls("recursive", shape, nodes, recursiveEqualPaths));
+            }
+            freeTree(nodes);
+        }
+
+        cerr << "n=" << n << " shape=forest" << endl;
+        vector<Node*> nodes;
+        vector<Node*> roots = buildForest(n, nodes);
+        vector<Node*>* forest = &roots;
+        results.push_back(timeCalls("iterative", FOREST, nodes, [forest](Node*) {
+            bool all = true;
+            for (size_t i = 0; i < forest->size(); ++i) all = equalPaths((*forest)[i]) && all;
+            return all;
+        }));
+        for (size_t t = 0; t < pools.size(); ++t) {
+            ThreadPool* pool = pools[t];
+            results.push_back(timeCalls("parallel-" + std::to_string(pool->size()), FOREST, nodes, [forest, pool](Node*) {
+                vector<char> answers;
+                parallelEqualPaths(*forest, answers, *pool);
+                return std::find(answers.begin(), answers.end(), 0) == answers.end();
+            }));
+        }
+        freeTree(nodes);
+    }
+    for (size_t t = 0; t < pools.size(); ++t) delete pools[t];
+
+    if (out.empty()) {
+        writeJson(cout, results);
+    } else {
+        ofstream ofs(out.c_str());
+        writeJson(ofs, results);
+    }
+    cerr << "checksum " << g_sink << endl;
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "equal-paths-parallel.h"
+#include "equal-paths-walk.h"
+using namespace std;
+
+// Subtree tasks to aim for per pool thread, so uneven subtrees still
+// keep every thread busy
+static const size_t TASKS_PER_THREAD = 4;
+
+// Levels the breadth-first split may expand before giving up on a tree
+// that stays too narrow to split
+static const int MAX_SPLIT_LEVELS = 32;
+
+// Leaves a task visits between checks of the shared mismatch flag
+static const size_t CANCEL_CHECK_INTERVAL = 1024;
+
+// Minimum and maximum leaf depth found in a subtree (-1 if none yet)
+struct LeafDepthRange
+{
+    int minDepth;
+    int maxDepth;
+};
+
+// State shared by the tasks checking one tree
+struct SharedScan
+{
+    atomic<bool> mismatch;
+    atomic<int> depth;      // first leaf depth any task found, -1 until then
+};
+
+/**
+ * Records a leaf depth in range. The first leaf a caller records is
+ * checked against the depth shared by all tasks (publishing it if it is
+ * the first anywhere); later ones only need to match that first one.
+ * Returns false once the depths cannot all be equal.
+ */
+static bool recordLeaf(int length, LeafDepthRange& range, SharedScan& shared)
+{
+    if (range.minDepth < 0) {
+        range.minDepth = range.maxDepth = length;
+        int expected = -1;
+        if (shared.depth.compare_exchange_strong(expected, length) || expected == length) return true;
+    } else {
+        range.minDepth = min(range.minDepth, length);
+        range.maxDepth = max(range.maxDepth, length);
+        if (range.minDepth == range.maxDepth) return true;
+    }
+    shared.mismatch.store(true);
+    return false;
+}
+
+// Records each leaf of a task's subtree and polls the shared mismatch flag
+struct SubtreeVisitor
+{
+    SharedScan* shared;
+    LeafDepthRange* range;
+    size_t untilCheck;
+
+    bool inner(int) const
+    {
+        return true;
+    }
+
+    bool leaf(int length)
+    {
+        if (!recordLeaf(length, *range, *shared)) return false;
+        if (--untilCheck == 0) {
+            if (shared->mismatch.load(memory_order_relaxed)) return false;
+            untilCheck = CANCEL_CHECK_INTERVAL;
+        }
+        return true;
+    }
+};
+
+/**
+ * Walks the subtree under root (at depth rootLength) with the same
+ * walkLeaves as equalPaths, filling range. Stops early on a mismatch
+ * found here or by another task.
+ */
+static void scanSubtree(Node* root, int rootLength, SharedScan* shared, LeafDepthRange* range)
+{
+    SubtreeVisitor visit = { shared, range, CANCEL_CHECK_INTERVAL };
+    walkLeaves(root, rootLength, visit);
+}
+
+bool parallelEqualPaths(Node * root, ThreadPool& pool)
+{
+    if (!root) {
+        return true;
+    }
+
+    SharedScan shared;
+    shared.mismatch.store(false);
+    shared.depth.store(-1);
+
+    // Split breadth-first; leaves met on the way are checked right here
+    LeafDepthRange top = { -1, -1 };
+    vector<pair<Node*, int> > frontier(1, make_pair(root, 0));
+    size_t target = TASKS_PER_THREAD * pool.size();
+    for (int level = 0; level < MAX_SPLIT_LEVELS && frontier.size() < target; ++level) {
+        vector<pair<Node*, int> > next;
+        next.reserve(2 * frontier.size());
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            Node* n = frontier[i].first;
+            int length = frontier[i].second;
+            if (n->left == NULL && n->right == NULL) {
+                if (!recordLeaf(length, top, shared)) return false;
+                continue;
+            }
+            if (n->left != NULL) next.push_back(make_pair(n->left, length + 1));
+            if (n->right != NULL) next.push_back(make_pair(n->right, length + 1));
+        }
+        frontier.swap(next);
+        if (frontier.empty()) return true;
+    }
+
+    vector<LeafDepthRange> ranges(frontier.size(), top);
+    if (frontier.size() == 1 || pool.size() == 1) {
+        for (size_t i = 0; i < frontier.size() && !shared.mismatch.load(); ++i) {
+            scanSubtree(frontier[i].first, frontier[i].second, &shared, &ranges[i]);
+        }
+    } else {
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            Node* subtree = frontier[i].first;
+            int length = frontier[i].second;
+            LeafDepthRange* range = &ranges[i];
+            SharedScan* state = &shared;
+            pool.submit([subtree, length, state, range]() {
+                if (!state->mismatch.load(memory_order_relaxed)) scanSubtree(subtree, length, state, range);
+            });
+        }
+        pool.wait();
+    }
+
+    if (shared.mismatch.load()) return false;
+
+    // The shared depth already catches mismatches across tasks; combining
+    // the ranges double-checks that every task saw the same depths
+    LeafDepthRange all = top;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (ranges[i].minDepth < 0) continue;
+        if (all.minDepth < 0 || ranges[i].minDepth < all.minDepth) all.minDepth = ranges[i].minDepth;
+        all.maxDepth = max(all.maxDepth, ranges[i].maxDepth);
+    }
+    return all.minDepth == all.maxDepth;
+}
+
+void parallelEqualPaths(const vector<Node*>& roots, vector<char>& results, ThreadPool& pool)
+{
+    results.assign(roots.size(), 0);
+    if (roots.empty()) return;
+
+    atomic<size_t> nextTree(0);
+    size_t workers = min<size_t>(pool.size(), roots.size());
+    const vector<Node*>* trees = &roots;
+    char* out = &results[0];
+    atomic<size_t>* claim = &nextTree;
+    for (size_t w = 0; w < workers; ++w) {
+        pool.submit([trees, out, claim]() {
+            size_t i;
+            while ((i = claim->fetch_add(1)) < trees->size()) {
+                out[i] = equalPaths((*trees)[i]) ? 1 : 0;
+            }
+        });
+    }
+    pool.wait();
+}
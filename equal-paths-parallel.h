@@ -0,0 +1,40 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include <vector>
+#include "equal-paths.h"
+#include "thread-pool.h"
+
+/**
+ * @brief Parallel equalPaths for one large tree.
+ *
+ *        The top levels are expanded breadth-first until there are a few
+ *        subtrees per pool thread. Each subtree then becomes a task that
+ *        reports its minimum and maximum leaf depth. Tasks share the first
+ *        leaf depth any of them finds, and all of them stop once one sees
+ *        a different depth. Path-like trees that never get wide enough to
+ *        split run as a single task.
+ *
+ *        Waits for the whole pool, so the pool should not be running
+ *        unrelated work at the same time.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param pool Threads to run the subtree tasks on
+ */
+bool parallelEqualPaths(Node * root, ThreadPool& pool);
+
+/**
+ * @brief equalPaths for every tree of a forest, one task per tree.
+ *
+ *        Workers claim trees in order from a shared counter, so thousands
+ *        of small trees do not each pay for a queue round trip. Each tree
+ *        is checked with the sequential equalPaths.
+ *
+ * @param roots   Roots of the trees to check
+ * @param results Resized to roots.size(); results[i] is nonzero iff
+ *                equalPaths(roots[i])
+ * @param pool    Threads to run the trees on
+ */
+void parallelEqualPaths(const std::vector<Node*>& roots, std::vector<char>& results, ThreadPool& pool);
+
+#endif
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <cstdlib>
+#include <vector>
 #include "equal-paths.h"
+#include "equal-paths-parallel.h"
 using namespace std;
 
 
@@ -55,6 +57,95 @@ void test5(const char* msg)
   cout << msg << ": " <<   equalPaths(a) << endl;
 }
 
+// Recursive reference: depth of every leaf, or -1 if they differ
+int leafDepth(Node* n, int depth)
+{
+  if (n->left == NULL && n->right == NULL) return depth;
+  int l = n->left ? leafDepth(n->left, depth + 1) : -2;
+  int r = n->right ? leafDepth(n->right, depth + 1) : -2;
+  if (l == -1 || r == -1) return -1;
+  if (l == -2) return r;
+  if (r == -2) return l;
+  return l == r ? l : -1;
+}
+
+void freeTree(Node* n)
+{
+  if (n == NULL) return;
+  freeTree(n->left);
+  freeTree(n->right);
+  delete n;
+}
+
+Node* chain(int length)
+{
+  Node* n = new Node(length);
+  if (length > 0) n->left = chain(length - 1);
+  return n;
+}
+
+// Full tree of the given height whose nodes are pruned at random, so it
+// mixes one-child nodes with leaves at different depths
+Node* randomTree(int height, int pruneOdds)
+{
+  Node* n = new Node(height);
+  if (height == 0) return n;
+  if (rand() % pruneOdds != 0) n->left = randomTree(height - 1, pruneOdds);
+  if (rand() % pruneOdds != 0) n->right = randomTree(height - 1, pruneOdds);
+  return n;
+}
+
+// Spine of depth height where every spine node also has a right chain
+// ending at the same depth, so the walk stacks height entries (more than
+// fit on its local stack). bump != 0 lengthens one chain.
+Node* comb(int height, int bump)
+{
+  Node* root = new Node(0);
+  Node* spine = root;
+  for (int i = 1; i <= height; i++) {
+    spine->right = chain(height - i + (i == bump ? 1 : 0));
+    spine->left = new Node(i);
+    spine = spine->left;
+  }
+  return root;
+}
+
+// Checks equalPaths and both parallelEqualPaths overloads against the
+// recursive reference on random trees
+void test6(const char* msg)
+{
+  ThreadPool pool(4);
+  ThreadPool single(1);
+  std::vector<Node*> trees;
+  for (int i = 0; i < 200; i++) {
+    trees.push_back(randomTree(1 + rand() % 12, i % 2 == 0 ? 1000 : 2 + rand() % 20));
+  }
+  trees.push_back(comb(200, 0));
+  trees.push_back(comb(200, 150));
+  trees.push_back(chain(5000));
+
+  bool ok = true;
+  for (size_t i = 0; i < trees.size(); i++) {
+    bool expected = leafDepth(trees[i], 0) >= 0;
+    if (equalPaths(trees[i]) != expected
+        || parallelEqualPaths(trees[i], pool) != expected
+        || parallelEqualPaths(trees[i], single) != expected) {
+      cout << "  mismatch on tree " << i << endl;
+      ok = false;
+    }
+  }
+  std::vector<char> results;
+  parallelEqualPaths(trees, results, pool);
+  for (size_t i = 0; i < trees.size(); i++) {
+    if ((results[i] != 0) != equalPaths(trees[i])) {
+      cout << "  forest mismatch on tree " << i << endl;
+      ok = false;
+    }
+  }
+  cout << msg << ": " << ok << endl;
+  for (size_t i = 0; i < trees.size(); i++) freeTree(trees[i]);
+}
+
 int main()
 {
   a = new Node(1);
@@ -67,6 +158,7 @@ int main()
   test3("Test3");
   test4("Test4");
   test5("Test5");
+  test6("Test6");
  
   delete a;
   delete b;
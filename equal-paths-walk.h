@@ -0,0 +1,84 @@
+#ifndef EQUAL_PATHS_WALK_H
+#define EQUAL_PATHS_WALK_H
+
+#ifndef RECCHECK
+#include <cstddef>
+#include <utility>
+#include <vector>
+#endif
+
+#include "equal-paths.h"
+
+// Internal: the leaf walk shared by equalPaths and parallelEqualPaths
+
+/**
+ * Single pre-order pass over the tree under root (at depth rootLength)
+ * with an explicit stack, so degenerate trees of any depth cannot
+ * overflow the call stack.
+ *
+ * The walk follows the leftmost child down and only stacks right
+ * children of nodes that have both, so a path of any shape needs no
+ * stack at all. The first 64 entries live in arrays on the call stack;
+ * deeper ones spill into a vector, which stays unallocated for trees
+ * under that depth.
+ *
+ * visit.inner(length) is called before stepping below each inner node
+ * and visit.leaf(length) at each leaf, with the node's depth. Either one
+ * returning false stops the walk, which then returns false; it returns
+ * true once every leaf was visited.
+ */
+template<typename Visitor>
+bool walkLeaves(Node* root, int rootLength, Visitor& visit)
+{
+    const size_t LOCAL_STACK = 64;
+    Node* localNodes[LOCAL_STACK];
+    int localLengths[LOCAL_STACK];
+    size_t top = 0;
+    std::vector<std::pair<Node*, int> > spill;
+
+    Node* current = root;
+    int length = rootLength;
+
+    while (true) {
+        // Descend to the next leaf
+        while (current->left != NULL || current->right != NULL) {
+            if (!visit.inner(length)) {
+                return false;
+            }
+            ++length;
+            if (current->left == NULL) {
+                current = current->right;
+                continue;
+            }
+            if (current->right != NULL) {
+                if (top < LOCAL_STACK) {
+                    localNodes[top] = current->right;
+                    localLengths[top] = length;
+                    ++top;
+                } else {
+                    spill.push_back(std::make_pair(current->right, length));
+                }
+            }
+            current = current->left;
+        }
+
+        if (!visit.leaf(length)) {
+            return false;
+        }
+
+        // Spilled entries were pushed last, so they come off first
+        if (!spill.empty()) {
+            current = spill.back().first;
+            length = spill.back().second;
+            spill.pop_back();
+        } else if (top > 0) {
+            --top;
+            current = localNodes[top];
+            length = localLengths[top];
+        } else {
+            return true;
+        }
+    }
+}
+
+#endif
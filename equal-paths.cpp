@@ -3,89 +3,48 @@
 #endif
 
 #include "equal-paths.h"
+#include "equal-paths-walk.h"
 using namespace std;
 
 
 // You may add any prototypes of helper functions here
 
-// Returns the length of the leftmost path in the tree
-int basePathLength(Node * root, int length);
 
-// Function that compares each path length to the base path length
-bool checkPathLength(Node * root, int length);
-
-
-int basePathLength(Node * root, int length)
+/**
+ * Checks leaf depths during one walkLeaves pass (see equal-paths-walk.h).
+ * The first leaf reached fixes the expected depth; the walk stops at the
+ * first leaf that differs.
+ */
+struct EqualDepthVisitor
 {
+    int baseLength;
 
-    /**
-     * Base case: Root is null
-     * 
-     * Desired Action: Return 0
-     */
-    if (root == NULL) {
-        return 0;
+    // Once baseLength is known, a path that reaches it at an inner node
+    // cannot end at a matching leaf
+    bool inner(int length) const
+    {
+        return length != baseLength;
     }
-    
-    /**
-     * Base case: Current node is a leaf node
-     * 
-     * Desired Action: Return length
-     */
-    if (root->left == NULL && root->right == NULL) {
-        return length;
-    }  
 
-    /**
-     * Recursive case: Proceed to left child if it exists, otherwise right child
-     * 
-     * Desired Action: Increment length and proceed to next nodes
-    */
-    if (root->left != NULL) {
-        return basePathLength(root->left, length+1);
-    } else {
-        return basePathLength(root->right, length+1);
+    // The first leaf sets baseLength, every later one must match it
+    bool leaf(int length)
+    {
+        if (baseLength < 0) {
+            baseLength = length;
+            return true;
+        }
+        return length == baseLength;
     }
-
-}
-
-bool checkPathLength(Node * root, int length, int baseLength)
-{  
-    /**
-     * Base case: Node is null
-     * 
-     * Desired action: return true (X && 1 = X)
-    */
-    if (root == NULL) {
-        return true;
-    }
-    /**
-     * Base case: Node is a leaf
-     * 
-     * Desired action: return true if length = baseLength, false otherwise
-    */
-    if (root->left == NULL && root->right == NULL) {
-        return (length == baseLength);
-    }
-
-    /**
-     * Recursive case: Node has a child
-     * 
-     * Desired action: Increment length and move on
-    */
-   return (checkPathLength(root->left, length+1, baseLength) && checkPathLength(root->right, length+1, baseLength));
-
-}
-
+};
 
 bool equalPaths(Node * root)
 {
     // Add your code below
     if (!root) {
         return true;
-    } else {
-        int baseLength = basePathLength(root, 0);
-        return checkPathLength(root, 0, baseLength);
     }
+
+    EqualDepthVisitor visit = { -1 };
+    return walkLeaves(root, 0, visit);
 }
 
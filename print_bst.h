@@ -3,6 +3,8 @@
 #include <map>
 #include <vector>
 #include <cstdint>
+#include <string>
+#include <type_traits>
 
 #ifndef PRINT_BST_H
 #define PRINT_BST_H
@@ -17,8 +19,8 @@
 // 1 means that it is the root.
 // Returns -1 (not found) if the distance is more than PPBST_MAX_HEIGHT,
 // or -2 if the tree is inconsistent.
-template<typename Key, typename Value>
-int getNodeDepth(BinarySearchTree<Key, Value> const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
+template<typename Key, typename Value, typename Compare>
+int getNodeDepth(BinarySearchTree<Key, Value, Compare> const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
 {
     int dist = 1;
 
@@ -92,8 +94,8 @@ int getSubtreeHeight(Node<Key, Value> * root, int recursionDepth = 1)
 
     */
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::printRoot (Node<Key, Value>* root) const
 {
     // special case for empty trees:
     if(root == nullptr)
@@ -130,7 +132,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
     std::map<Key, uint8_t> valuePlaceholders;
 
     uint8_t nextPlaceHolderVal = 1;
-    for(typename BinarySearchTree<Key, Value>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
+    for(typename BinarySearchTree<Key, Value, Compare>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
     {
 
         if(getNodeDepth(*this, root, treeIter.current_) != -1)
@@ -273,7 +275,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
             std::cout.flags(origCoutState);
             std::cout << '(' << placeholdersIter->first << ", ";
 
-            typename BinarySearchTree<Key, Value>::iterator elementIter = this->find(placeholdersIter->first);
+            typename BinarySearchTree<Key, Value, Compare>::iterator elementIter = this->find(placeholdersIter->first);
             if(elementIter == this->end())
             {
                 std::cout << "<error: lookup failed>";
@@ -294,4 +296,322 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
 
 }
 
+/* Streaming exporters: Graphviz DOT and JSON.
+
+   Unlike printRoot(), these have no height limit and build no layout:
+   each node is written to the stream as soon as it is visited in a single
+   pre-order walk that follows parent pointers, so memory use is O(1)
+   regardless of tree size or depth. Node ids are the node addresses.
+
+   DOT output:
+   digraph BST {
+       "0x1234" [label="5: foo"];
+       "0x1234" -> "0x5678" [label="L"];
+       ...
+   }
+
+   JSON output is a flat node list, so even degenerate trees don't nest:
+   {"nodes": [
+   {"id": "0x1234", "depth": 1, "key": 5, "value": "foo", "parent": null, "left": "0x5678", "right": null},
+   ...
+   ], "truncated": false}
+
+   Output stops early after maxDepth levels or maxNodes nodes
+   (0 = unlimited); JSON then reports "truncated": true.
+*/
+
+// Writes one character escaped so it is valid inside a quoted DOT or JSON
+// string: quotes and backslashes get a backslash, newlines become \n and
+// every other control character becomes \u00XX
+inline void ppbstWriteEscapedChar(std::ostream& os, char c)
+{
+    unsigned char byte = static_cast<unsigned char>(c);
+    if(c == '"' || c == '\\')
+    {
+        os << '\\' << c;
+    }
+    else if(c == '\n')
+    {
+        os << "\\n";
+    }
+    else if(byte < 0x20 || byte == 0x7f)
+    {
+        const char* hex = "0123456789abcdef";
+        os << "\\u00" << hex[byte >> 4] << hex[byte & 0xf];
+    }
+    else
+    {
+        os << c;
+    }
+}
+
+// Stream buffer that escapes everything written through it into another stream
+class PpbstEscapingBuf : public std::streambuf
+{
+public:
+    explicit PpbstEscapingBuf(std::ostream& os) : os_(os) {}
+protected:
+    virtual int_type overflow(int_type c)
+    {
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            ppbstWriteEscapedChar(os_, traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+private:
+    std::ostream& os_;
+};
+
+inline void ppbstWriteEscaped(std::ostream& os, const std::string& str)
+{
+    for(std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+        ppbstWriteEscapedChar(os, *it);
+    }
+}
+
+inline void ppbstWriteEscaped(std::ostream& os, char c)
+{
+    ppbstWriteEscapedChar(os, c);
+}
+
+// signed/unsigned char are almost always small integers (int8_t, uint8_t)
+inline void ppbstWriteEscaped(std::ostream& os, signed char c)
+{
+    os << static_cast<int>(c);
+}
+
+inline void ppbstWriteEscaped(std::ostream& os, unsigned char c)
+{
+    os << static_cast<unsigned>(c);
+}
+
+// Numbers cannot produce quotes or control bytes, so they go straight out
+template<typename T>
+void ppbstWriteEscaped(std::ostream& os, const T& v, std::true_type)
+{
+    os << v;
+}
+
+// Other types are written with their operator<<, escaped on the way out
+template<typename T>
+void ppbstWriteEscaped(std::ostream& os, const T& v, std::false_type)
+{
+    PpbstEscapingBuf buf(os);
+    std::ostream escaped(&buf);
+    escaped.flags(os.flags());
+    escaped.precision(os.precision());
+    escaped << v;
+}
+
+template<typename T>
+void ppbstWriteEscaped(std::ostream& os, const T& v)
+{
+    ppbstWriteEscaped(os, v, std::is_arithmetic<T>());
+}
+
+// JSON has no NaN or infinity, so those are written as null
+template<typename T>
+void ppbstWriteJsonNumber(std::ostream& os, const T& v)
+{
+    // unary + prints int8_t/uint8_t as numbers instead of raw bytes
+    os << +v;
+}
+
+inline void ppbstWriteJsonNumber(std::ostream& os, bool v)
+{
+    os << (v ? "true" : "false");
+}
+
+inline void ppbstWriteJsonNumber(std::ostream& os, float v)
+{
+    if(std::isfinite(v)) os << v;
+    else os << "null";
+}
+
+inline void ppbstWriteJsonNumber(std::ostream& os, double v)
+{
+    if(std::isfinite(v)) os << v;
+    else os << "null";
+}
+
+inline void ppbstWriteJsonNumber(std::ostream& os, long double v)
+{
+    if(std::isfinite(v)) os << v;
+    else os << "null";
+}
+
+template<typename T>
+void ppbstWriteJsonValue(std::ostream& os, const T& v, std::true_type)
+{
+    ppbstWriteJsonNumber(os, v);
+}
+
+template<typename T>
+void ppbstWriteJsonValue(std::ostream& os, const T& v, std::false_type)
+{
+    os << '"';
+    ppbstWriteEscaped(os, v);
+    os << '"';
+}
+
+template<typename T>
+void ppbstWriteJsonValue(std::ostream& os, const T& v)
+{
+    // plain char is a character, so quote it; every other arithmetic type,
+    // including int8_t/uint8_t, is a number
+    ppbstWriteJsonValue(os, v, std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, char>::value>());
+}
+
+template<typename Key, typename Value>
+void ppbstWriteId(std::ostream& os, Node<Key, Value> const * node)
+{
+    if(node == nullptr)
+    {
+        os << "null";
+    }
+    else
+    {
+        os << '"' << static_cast<void const *>(node) << '"';
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportDot(std::ostream& os, int maxDepth, size_t maxNodes) const
+{
+    exportRoot(root_, os, false, maxDepth, maxNodes);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportSubtreeDot(std::ostream& os, const Key& subtreeKey, int maxDepth, size_t maxNodes) const
+{
+    exportRoot(internalFind(subtreeKey), os, false, maxDepth, maxNodes);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportJson(std::ostream& os, int maxDepth, size_t maxNodes) const
+{
+    exportRoot(root_, os, true, maxDepth, maxNodes);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportSubtreeJson(std::ostream& os, const Key& subtreeKey, int maxDepth, size_t maxNodes) const
+{
+    exportRoot(internalFind(subtreeKey), os, true, maxDepth, maxNodes);
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportRoot(Node<Key, Value>* root, std::ostream& os, bool json, int maxDepth, size_t maxNodes) const
+{
+    if(json)
+    {
+        os << "{\"nodes\": [\n";
+    }
+    else
+    {
+        os << "digraph BST {\n    node [shape=box];\n";
+    }
+
+    size_t emitted = 0;
+    bool truncated = false;
+    int depth = 1;
+    Node<Key, Value>* prev = (root == nullptr) ? nullptr : root->getParent();
+    Node<Key, Value>* current = root;
+
+    while(current != nullptr)
+    {
+        Node<Key, Value>* left = current->getLeft();
+        Node<Key, Value>* right = current->getRight();
+        bool expand = (maxDepth <= 0 || depth < maxDepth);
+
+        // first visit: write the node, then descend left
+        if(prev == current->getParent())
+        {
+            if(maxNodes != 0 && emitted == maxNodes)
+            {
+                truncated = true;
+                break;
+            }
+
+            Node<Key, Value>* parent = (current == root) ? nullptr : current->getParent();
+            if(json)
+            {
+                os << (emitted == 0 ? "" : ",\n") << "{\"id\": ";
+                ppbstWriteId(os, current);
+                os << ", \"depth\": " << depth << ", \"key\": ";
+                ppbstWriteJsonValue(os, current->getKey());
+                os << ", \"value\": ";
+                ppbstWriteJsonValue(os, current->getValue());
+                os << ", \"parent\": ";
+                ppbstWriteId(os, parent);
+                os << ", \"left\": ";
+                ppbstWriteId(os, left);
+                os << ", \"right\": ";
+                ppbstWriteId(os, right);
+                os << "}";
+            }
+            else
+            {
+                os << "    ";
+                ppbstWriteId(os, current);
+                os << " [label=\"";
+                ppbstWriteEscaped(os, current->getKey());
+                os << ": ";
+                ppbstWriteEscaped(os, current->getValue());
+                os << "\"];\n";
+                if(parent != nullptr)
+                {
+                    os << "    ";
+                    ppbstWriteId(os, parent);
+                    os << " -> ";
+                    ppbstWriteId(os, current);
+                    os << (parent->getLeft() == current ? " [label=\"L\"];\n" : " [label=\"R\"];\n");
+                }
+            }
+            ++emitted;
+
+            if(expand && left != nullptr)
+            {
+                prev = current;
+                current = left;
+                ++depth;
+                continue;
+            }
+            if(!expand && (left != nullptr || right != nullptr))
+            {
+                truncated = true;
+            }
+            prev = left;
+        }
+
+        // back from the left subtree: descend right
+        if(prev == left && expand && right != nullptr)
+        {
+            prev = current;
+            current = right;
+            ++depth;
+            continue;
+        }
+
+        // both subtrees done: go back up
+        prev = current;
+        current = (current == root) ? nullptr : current->getParent();
+        --depth;
+    }
+
+    if(json)
+    {
+        os << "\n], \"truncated\": " << (truncated ? "true" : "false") << "}\n";
+    }
+    else
+    {
+        if(truncated)
+        {
+            os << "    // truncated by maxDepth/maxNodes\n";
+        }
+        os << "}\n";
+    }
+}
+
 #endif
@@ -0,0 +1,538 @@
+#ifndef RADIXMAP_H
+#define RADIXMAP_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+* A node of a RadixMap. Each node stores only the part of the key on the
+* edge from its parent (prefix_); the full key is the concatenation of
+* the prefixes from the root down. Children are kept sorted by the first
+* byte of their prefix, and no two children start with the same byte.
+*/
+template <typename Value>
+class RadixNode
+{
+public:
+    RadixNode(const char* prefix, size_t length, RadixNode<Value>* parent);
+
+    const std::string& getPrefix() const;
+    RadixNode<Value>* getParent() const;
+    bool hasValue() const;
+    Value& getValue();
+    const Value& getValue() const;
+
+protected:
+    template<typename V>
+    friend class RadixMap;
+
+    std::string prefix_;
+    RadixNode<Value>* parent_;
+    std::vector<RadixNode<Value>*> children_;
+    bool hasValue_;
+    Value value_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RadixNode class.
+  -----------------------------------------------
+*/
+
+template<typename Value>
+RadixNode<Value>::RadixNode(const char* prefix, size_t length, RadixNode<Value>* parent) :
+    prefix_(prefix, length), parent_(parent), hasValue_(false), value_()
+{
+
+}
+
+template<typename Value>
+const std::string& RadixNode<Value>::getPrefix() const
+{
+    return prefix_;
+}
+
+template<typename Value>
+RadixNode<Value>* RadixNode<Value>::getParent() const
+{
+    return parent_;
+}
+
+template<typename Value>
+bool RadixNode<Value>::hasValue() const
+{
+    return hasValue_;
+}
+
+template<typename Value>
+Value& RadixNode<Value>::getValue()
+{
+    return value_;
+}
+
+template<typename Value>
+const Value& RadixNode<Value>::getValue() const
+{
+    return value_;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RadixNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A prefix-compressed (radix) tree mapping std::string keys to values,
+* with the insert/remove/find/operator[]/iterator API of BinarySearchTree.
+*
+* Keys that share a prefix share the nodes for it, so long keys with
+* common prefixes (URLs, paths) are stored once per distinct suffix
+* instead of once per key. A lookup inspects each byte of the key at most
+* once and never compares it against a whole stored key, unlike a BST
+* descent which compares full strings at every level.
+*
+* Iteration is in std::string order (bytes compared as unsigned char).
+* Keys are rebuilt by the iterator, so it dereferences to a small
+* reference object with first (const std::string&) and second (Value&)
+* rather than to a stored std::pair.
+*
+* Value must be default constructible.
+*/
+template <typename Value>
+class RadixMap
+{
+public:
+    RadixMap();
+    // Moves take other's nodes in O(1) and leave other empty. The map owns
+    // its nodes, so it is not copyable.
+    RadixMap(RadixMap&& other);
+    RadixMap& operator=(RadixMap&& other);
+    RadixMap(const RadixMap&) = delete;
+    RadixMap& operator=(const RadixMap&) = delete;
+    virtual ~RadixMap();
+    // Exchanges contents with other in O(1)
+    void swap(RadixMap& other);
+    void insert(const std::pair<const std::string, Value>& keyValuePair);
+    void remove(const std::string& key);
+    void remove(const char* key);
+    void clear();
+    bool empty() const;
+
+    class iterator
+    {
+    public:
+        struct reference
+        {
+            const std::string& first;
+            Value& second;
+        };
+        struct pointer
+        {
+            reference ref;
+            const reference* operator->() const { return &ref; }
+        };
+
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class RadixMap<Value>;
+        iterator(RadixNode<Value>* node, const std::string& key);
+
+        // Moves to the next node in pre-order that holds a value
+        void advance();
+
+        RadixNode<Value>* current_;
+        std::string key_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const std::string& key) const;
+    iterator find(const char* key) const;
+    Value& operator[](const std::string& key);
+    Value const & operator[](const std::string& key) const;
+
+protected:
+    // Finds the node holding exactly key[0, length), or NULL
+    RadixNode<Value>* findNode(const char* key, size_t length) const;
+
+    void removeKey(const char* key, size_t length);
+
+    // Index of the child whose prefix starts with c, or -1
+    static int childIndex(const RadixNode<Value>* node, unsigned char c);
+
+    // Inserts child into node's children, keeping them sorted
+    static void addChild(RadixNode<Value>* node, RadixNode<Value>* child);
+
+    // Splices a value-less node with a single child into that child
+    void mergeWithChild(RadixNode<Value>* node);
+
+    // Root has an empty prefix and holds the value of the empty key
+    RadixNode<Value>* root_;
+};
+
+template<typename Value>
+RadixMap<Value>::RadixMap() : root_(new RadixNode<Value>("", 0, NULL))
+{
+
+}
+
+/**
+* other keeps a fresh empty root, since every map has one.
+*/
+template<typename Value>
+RadixMap<Value>::RadixMap(RadixMap&& other) : root_(new RadixNode<Value>("", 0, NULL))
+{
+    swap(other);
+}
+
+/**
+* Frees this map's nodes, then takes other's. other ends up empty.
+*/
+template<typename Value>
+RadixMap<Value>& RadixMap<Value>::operator=(RadixMap&& other)
+{
+    if (this != &other) {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+template<typename Value>
+void RadixMap<Value>::swap(RadixMap& other)
+{
+    std::swap(root_, other.root_);
+}
+
+template<typename Value>
+RadixMap<Value>::~RadixMap()
+{
+    clear();
+    delete root_;
+}
+
+template<typename Value>
+bool RadixMap<Value>::empty() const
+{
+    return !root_->hasValue_ && root_->children_.empty();
+}
+
+/**
+* Deletes every node but the root, without recursion.
+*/
+template<typename Value>
+void RadixMap<Value>::clear()
+{
+    std::vector<RadixNode<Value>*> pending(root_->children_);
+    while (!pending.empty()) {
+        RadixNode<Value>* n = pending.back();
+        pending.pop_back();
+        pending.insert(pending.end(), n->children_.begin(), n->children_.end());
+        delete n;
+    }
+    root_->children_.clear();
+    root_->hasValue_ = false;
+    root_->value_ = Value();
+}
+
+template<typename Value>
+int RadixMap<Value>::childIndex(const RadixNode<Value>* node, unsigned char c)
+{
+    // Binary search by first byte
+    int lo = 0, hi = (int)node->children_.size() - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        unsigned char first = (unsigned char)node->children_[mid]->prefix_[0];
+        if (first == c) return mid;
+        if (first < c) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+template<typename Value>
+void RadixMap<Value>::addChild(RadixNode<Value>* node, RadixNode<Value>* child)
+{
+    unsigned char c = (unsigned char)child->prefix_[0];
+    typename std::vector<RadixNode<Value>*>::iterator it = node->children_.begin();
+    while (it != node->children_.end() && (unsigned char)(*it)->prefix_[0] < c) ++it;
+    node->children_.insert(it, child);
+    child->parent_ = node;
+}
+
+/**
+* Recall: If key is already in the tree, you should
+* overwrite the current value with the updated value.
+*/
+template<typename Value>
+void RadixMap<Value>::insert(const std::pair<const std::string, Value>& keyValuePair)
+{
+    const char* key = keyValuePair.first.data();
+    size_t length = keyValuePair.first.size();
+    RadixNode<Value>* current = root_;
+    size_t pos = 0;
+
+    while (pos < length) {
+        int idx = childIndex(current, (unsigned char)key[pos]);
+
+        // No edge starts with this byte: the rest of the key becomes a leaf
+        if (idx < 0) {
+            RadixNode<Value>* leaf = new RadixNode<Value>(key + pos, length - pos, current);
+            leaf->hasValue_ = true;
+            leaf->value_ = keyValuePair.second;
+            addChild(current, leaf);
+            return;
+        }
+
+        // Only the edge label is compared, never the consumed part of the key
+        RadixNode<Value>* child = current->children_[idx];
+        const std::string& prefix = child->prefix_;
+        size_t common = 1;
+        while (common < prefix.size() && pos + common < length && prefix[common] == key[pos + common]) ++common;
+
+        if (common < prefix.size()) {
+            // Split the edge: a new node takes the shared part
+            RadixNode<Value>* mid = new RadixNode<Value>(prefix.data(), common, current);
+            current->children_[idx] = mid;
+            child->prefix_.erase(0, common);
+            mid->children_.push_back(child);
+            child->parent_ = mid;
+            child = mid;
+        }
+        current = child;
+        pos += common;
+    }
+
+    current->hasValue_ = true;
+    current->value_ = keyValuePair.second;
+}
+
+template<typename Value>
+RadixNode<Value>* RadixMap<Value>::findNode(const char* key, size_t length) const
+{
+    RadixNode<Value>* current = root_;
+    size_t pos = 0;
+    while (pos < length) {
+        int idx = childIndex(current, (unsigned char)key[pos]);
+        if (idx < 0) return NULL;
+
+        current = current->children_[idx];
+        const std::string& prefix = current->prefix_;
+        if (prefix.size() > length - pos) return NULL;
+        // First byte already matched by childIndex
+        if (std::memcmp(prefix.data() + 1, key + pos + 1, prefix.size() - 1) != 0) return NULL;
+        pos += prefix.size();
+    }
+    return current->hasValue_ ? current : NULL;
+}
+
+template<typename Value>
+void RadixMap<Value>::remove(const std::string& key)
+{
+    removeKey(key.data(), key.size());
+}
+
+template<typename Value>
+void RadixMap<Value>::remove(const char* key)
+{
+    removeKey(key, std::strlen(key));
+}
+
+/**
+* Clears the node's value, then restores compression: a value-less leaf
+* is deleted, and a value-less node left with one child is merged into it.
+*/
+template<typename Value>
+void RadixMap<Value>::removeKey(const char* key, size_t length)
+{
+    RadixNode<Value>* current = findNode(key, length);
+    if (current == NULL) return;
+
+    current->hasValue_ = false;
+    current->value_ = Value();
+    if (current == root_) return;
+
+    if (current->children_.empty()) {
+        RadixNode<Value>* parent = current->parent_;
+        int idx = childIndex(parent, (unsigned char)current->prefix_[0]);
+        parent->children_.erase(parent->children_.begin() + idx);
+        delete current;
+
+        // The parent may now be a pass-through node
+        if (parent != root_ && !parent->hasValue_ && parent->children_.size() == 1) {
+            mergeWithChild(parent);
+        }
+    } else if (current->children_.size() == 1) {
+        mergeWithChild(current);
+    }
+}
+
+template<typename Value>
+void RadixMap<Value>::mergeWithChild(RadixNode<Value>* node)
+{
+    RadixNode<Value>* child = node->children_[0];
+    RadixNode<Value>* parent = node->parent_;
+    child->prefix_.insert(0, node->prefix_);
+    child->parent_ = parent;
+    parent->children_[childIndex(parent, (unsigned char)node->prefix_[0])] = child;
+    delete node;
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator RadixMap<Value>::begin() const
+{
+    iterator it(root_, "");
+    if (!root_->hasValue_) it.advance();
+    return it;
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator RadixMap<Value>::end() const
+{
+    return iterator();
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator RadixMap<Value>::find(const std::string& key) const
+{
+    RadixNode<Value>* n = findNode(key.data(), key.size());
+    return (n == NULL) ? end() : iterator(n, key);
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator RadixMap<Value>::find(const char* key) const
+{
+    size_t length = std::strlen(key);
+    RadixNode<Value>* n = findNode(key, length);
+    return (n == NULL) ? end() : iterator(n, std::string(key, length));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<typename Value>
+Value& RadixMap<Value>::operator[](const std::string& key)
+{
+    RadixNode<Value>* n = findNode(key.data(), key.size());
+    if (n == NULL) throw std::out_of_range("Invalid key");
+    return n->value_;
+}
+
+template<typename Value>
+Value const & RadixMap<Value>::operator[](const std::string& key) const
+{
+    RadixNode<Value>* n = findNode(key.data(), key.size());
+    if (n == NULL) throw std::out_of_range("Invalid key");
+    return n->value_;
+}
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RadixMap::iterator class.
+  -----------------------------------------------
+*/
+
+template<typename Value>
+RadixMap<Value>::iterator::iterator() : current_(NULL)
+{
+
+}
+
+template<typename Value>
+RadixMap<Value>::iterator::iterator(RadixNode<Value>* node, const std::string& key) :
+    current_(node), key_(key)
+{
+
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator::reference RadixMap<Value>::iterator::operator*() const
+{
+    reference ref = { key_, current_->value_ };
+    return ref;
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator::pointer RadixMap<Value>::iterator::operator->() const
+{
+    pointer ptr = { **this };
+    return ptr;
+}
+
+template<typename Value>
+bool RadixMap<Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<typename Value>
+bool RadixMap<Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+template<typename Value>
+typename RadixMap<Value>::iterator& RadixMap<Value>::iterator::operator++()
+{
+    advance();
+    return *this;
+}
+
+/**
+* Pre-order with children sorted by first byte is key order, because a
+* node's key is a prefix of (so sorts before) every key below it.
+*/
+template<typename Value>
+void RadixMap<Value>::iterator::advance()
+{
+    do {
+        if (!current_->children_.empty()) {
+            current_ = current_->children_[0];
+            key_ += current_->prefix_;
+            continue;
+        }
+
+        // Climb until some ancestor has a next sibling
+        while (true) {
+            RadixNode<Value>* parent = current_->parent_;
+            if (parent == NULL) {
+                current_ = NULL;
+                key_.clear();
+                return;
+            }
+            key_.resize(key_.size() - current_->prefix_.size());
+            size_t idx = childIndex(parent, (unsigned char)current_->prefix_[0]) + 1;
+            if (idx < parent->children_.size()) {
+                current_ = parent->children_[idx];
+                key_ += current_->prefix_;
+                break;
+            }
+            current_ = parent;
+        }
+    } while (!current_->hasValue_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RadixMap::iterator class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A node for a red-black tree, which adds the node's color.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor. New nodes are red.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+
+    // Getter/setter for the node's color.
+    bool isRed() const;
+    void setRed(bool red);
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to RBNodes - not plain Nodes.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    bool red_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), red_(true)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+/**
+* A getter for the color of a RBNode.
+*/
+template<class Key, class Value>
+bool RBNode<Key, Value>::isRed() const
+{
+    return red_;
+}
+
+/**
+* A setter for the color of a RBNode.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setRed(bool red)
+{
+    red_ = red;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a RBNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A red-black tree. Compared to AVLTree it allows slightly taller trees
+* (height <= 2 log n) in exchange for cheaper rebalancing: an insert does
+* at most 2 rotations and a remove at most 3, with only recoloring
+* propagating up the tree.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class RedBlackTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    explicit RedBlackTree(const Compare& comp = Compare());
+    virtual void insert(const std::pair<const Key, Value> &new_item);
+
+    // Copies shape and colors node by node in O(n)
+    RedBlackTree clone() const;
+protected:
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual void nodeSwap(RBNode<Key, Value>* n1, RBNode<Key, Value>* n2);
+    virtual Node<Key, Value>* copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const;
+
+    // NULL children count as black
+    static bool isRed(RBNode<Key, Value>* n);
+
+    // Restores the red-black properties after n was attached as a red leaf
+    void insertFix(RBNode<Key, Value>* n);
+
+    // Restores the black height after a black node was removed from
+    // parent's left (isLeft) or right side; x is the node that took its place
+    void removeFix(RBNode<Key, Value>* x, RBNode<Key, Value>* parent, bool isLeft);
+};
+
+template<class Key, class Value, class Compare>
+RedBlackTree<Key, Value, Compare>::RedBlackTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+RedBlackTree<Key, Value, Compare> RedBlackTree<Key, Value, Compare>::clone() const
+{
+    RedBlackTree<Key, Value, Compare> copy(this->comp_);
+    this->copyInto(copy);
+    return copy;
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* RedBlackTree<Key, Value, Compare>::copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const
+{
+    const RBNode<Key, Value>* from = static_cast<const RBNode<Key, Value>*>(n);
+    RBNode<Key, Value>* to = new RBNode<Key, Value>(from->getKey(), from->getValue(),
+                                                    static_cast<RBNode<Key, Value>*>(parent));
+    to->setRed(from->isRed());
+    return to;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::insert(const std::pair<const Key, Value> &new_item)
+{
+    if (this->root_ == NULL) {
+        RBNode<Key, Value>* newNode = new RBNode<Key, Value>(new_item.first, new_item.second, NULL);
+        newNode->setRed(false);
+        this->root_ = newNode;
+        this->noteInserted(newNode);
+        return;
+    }
+
+    RBNode<Key, Value>* current = static_cast<RBNode<Key, Value>*>(this->root_);
+    int c;
+    while (true) {
+        c = this->compareKeys(new_item.first, current->getKey());
+        if (c == 0) {
+            current->setValue(new_item.second);
+            return;
+        }
+
+        RBNode<Key, Value>* next = (c < 0) ? current->getLeft() : current->getRight();
+        if (next == NULL) break;
+        current = next;
+    }
+
+    RBNode<Key, Value>* newNode = new RBNode<Key, Value>(new_item.first, new_item.second, current);
+    this->noteInserted(newNode);
+    if (c < 0) {
+        current->setLeft(newNode);
+    } else {
+        current->setRight(newNode);
+    }
+    insertFix(newNode);
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::insertFix(RBNode<Key, Value>* n)
+{
+    // Loop while there is a red node with a red parent
+    while (isRed(n->getParent())) {
+        RBNode<Key, Value>* parent = n->getParent();
+        // parent is red so it is not the root, and grandparent exists
+        RBNode<Key, Value>* grandparent = parent->getParent();
+        bool parentIsLeft = (grandparent->getLeft() == parent);
+        RBNode<Key, Value>* uncle = parentIsLeft ? grandparent->getRight() : grandparent->getLeft();
+
+        // Case 1: red uncle, recolor and continue from grandparent
+        if (isRed(uncle)) {
+            parent->setRed(false);
+            uncle->setRed(false);
+            grandparent->setRed(true);
+            n = grandparent;
+            continue;
+        }
+
+        // Case 2: n is an inner child, rotate it to the outside
+        if (parentIsLeft && parent->getRight() == n) {
+            this->leftRotate(parent, n);
+            n = parent;
+            parent = n->getParent();
+        } else if (!parentIsLeft && parent->getLeft() == n) {
+            this->rightRotate(parent, n);
+            n = parent;
+            parent = n->getParent();
+        }
+
+        // Case 3: n is an outer child, rotate grandparent down
+        parent->setRed(false);
+        grandparent->setRed(true);
+        if (parentIsLeft) {
+            this->rightRotate(grandparent, parent);
+        } else {
+            this->leftRotate(grandparent, parent);
+        }
+        break;
+    }
+    static_cast<RBNode<Key, Value>*>(this->root_)->setRed(false);
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* node)
+{
+    RBNode<Key, Value>* current = static_cast<RBNode<Key, Value>*>(node);
+    this->noteErasing(current);
+
+    // Two children case: swap with predecessor (colors stay with positions)
+    if (current->getLeft() != NULL && current->getRight() != NULL) {
+        nodeSwap(current, static_cast<RBNode<Key, Value>*>(this->predecessor(current)));
+    }
+
+    // current now has at most one child
+    RBNode<Key, Value>* parent = current->getParent();
+    RBNode<Key, Value>* child = (current->getLeft() != NULL) ? current->getLeft() : current->getRight();
+    bool isLeft = (parent != NULL && parent->getLeft() == current);
+    bool removedBlack = !current->isRed();
+
+    if (child != NULL) {
+        this->promoteNode(current, parent, child);
+    } else {
+        this->removeNode(current);
+    }
+
+    if (removedBlack) {
+        removeFix(child, parent, isLeft);
+    }
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::removeFix(RBNode<Key, Value>* x, RBNode<Key, Value>* parent, bool isLeft)
+{
+    // x carries an extra black until it is red (recolor it) or the root
+    while (parent != NULL && !isRed(x)) {
+        RBNode<Key, Value>* sibling = isLeft ? parent->getRight() : parent->getLeft();
+
+        // Case 1: red sibling, rotate so that the sibling is black
+        if (isRed(sibling)) {
+            sibling->setRed(false);
+            parent->setRed(true);
+            if (isLeft) {
+                this->leftRotate(parent, sibling);
+                sibling = parent->getRight();
+            } else {
+                this->rightRotate(parent, sibling);
+                sibling = parent->getLeft();
+            }
+        }
+
+        RBNode<Key, Value>* outer = isLeft ? sibling->getRight() : sibling->getLeft();
+        RBNode<Key, Value>* inner = isLeft ? sibling->getLeft() : sibling->getRight();
+
+        // Case 2: black sibling with black children, push the extra black up
+        if (!isRed(outer) && !isRed(inner)) {
+            sibling->setRed(true);
+            x = parent;
+            parent = x->getParent();
+            if (parent != NULL) isLeft = (parent->getLeft() == x);
+            continue;
+        }
+
+        // Case 3: only the inner nephew is red, rotate it to the outside
+        if (!isRed(outer)) {
+            inner->setRed(false);
+            sibling->setRed(true);
+            if (isLeft) {
+                this->rightRotate(sibling, inner);
+            } else {
+                this->leftRotate(sibling, inner);
+            }
+            outer = sibling;
+            sibling = inner;
+        }
+
+        // Case 4: red outer nephew, rotate parent down and finish
+        sibling->setRed(parent->isRed());
+        parent->setRed(false);
+        outer->setRed(false);
+        if (isLeft) {
+            this->leftRotate(parent, sibling);
+        } else {
+            this->rightRotate(parent, sibling);
+        }
+        return;
+    }
+    if (x != NULL) x->setRed(false);
+}
+
+template<class Key, class Value, class Compare>
+bool RedBlackTree<Key, Value, Compare>::isRed(RBNode<Key, Value>* n)
+{
+    return n != NULL && n->isRed();
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::nodeSwap(RBNode<Key, Value>* n1, RBNode<Key, Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    bool tempRed = n1->isRed();
+    n1->setRed(n2->isRed());
+    n2->setRed(tempRed);
+}
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A self-adjusting binary search tree. Every find, insert and remove
+* splays the node it touched to the root, so frequently accessed keys
+* stay near the top and skewed (e.g. Zipfian) lookups get cheaper than
+* in a tree with a fixed shape. Operations are O(log n) amortized.
+*
+* Uses plain Nodes and reuses the BinarySearchTree rotations, nodeSwap,
+* successor/predecessor and iterator.
+*
+* Only the non-const find/operator[] splay; on a const tree they behave
+* like the BinarySearchTree versions.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class SplayTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+
+    explicit SplayTree(const Compare& comp = Compare());
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    using BinarySearchTree<Key, Value, Compare>::remove;
+    virtual void remove(const Key& key);
+    template<typename K>
+    void remove(const K& key);
+
+    using BinarySearchTree<Key, Value, Compare>::find;
+    using BinarySearchTree<Key, Value, Compare>::operator[];
+    iterator find(const Key& key);
+    template<typename K>
+    iterator find(const K& key);
+    Value& operator[](const Key& key);
+
+    // Copies the current shape node by node in O(n)
+    SplayTree clone() const;
+
+protected:
+    // Splays the node to the root, then unlinks it
+    virtual void eraseNode(Node<Key, Value>* node);
+
+    // Rotates n up to the root using zig, zig-zig and zig-zag steps
+    void splay(Node<Key, Value>* n);
+
+    // Finds the node with the given key and splays it to the root. If the key
+    // is missing, splays the last node on the search path and returns NULL.
+    // K may be any type comparable with Key, as for BinarySearchTree::find.
+    template<typename K>
+    Node<Key, Value>* splayFind(const K& key);
+};
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare> SplayTree<Key, Value, Compare>::clone() const
+{
+    SplayTree<Key, Value, Compare> copy(this->comp_);
+    this->copyInto(copy);
+    return copy;
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& new_item)
+{
+    if (this->root_ == NULL) {
+        this->root_ = new Node<Key, Value>(new_item.first, new_item.second, NULL);
+        this->noteInserted(this->root_);
+        return;
+    }
+
+    Node<Key, Value>* current = this->root_;
+    int c;
+    while (true) {
+        c = this->compareKeys(new_item.first, current->getKey());
+
+        // Key is already in tree: overwrite value
+        if (c == 0) {
+            current->setValue(new_item.second);
+            break;
+        }
+
+        Node<Key, Value>* next = (c < 0) ? current->getLeft() : current->getRight();
+        if (next == NULL) {
+            Node<Key, Value>* newNode = new Node<Key, Value>(new_item.first, new_item.second, current);
+            this->noteInserted(newNode);
+            if (c < 0) {
+                current->setLeft(newNode);
+            } else {
+                current->setRight(newNode);
+            }
+            current = newNode;
+            break;
+        }
+        current = next;
+    }
+    splay(current);
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::remove(const Key& key)
+{
+    Node<Key, Value>* current = splayFind(key);
+    if (current != NULL) eraseNode(current);
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+void SplayTree<Key, Value, Compare>::remove(const K& key)
+{
+    Node<Key, Value>* current = splayFind(key);
+    if (current != NULL) eraseNode(current);
+}
+
+/*
+ * Splays the node to the root, then removes it like the other trees do:
+ * a node with two children is swapped with its predecessor first. The
+ * removed node's parent is splayed afterwards to pay for the walk down
+ * to the predecessor.
+ */
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* current)
+{
+    this->noteErasing(current);
+    splay(current);
+    if (current->getLeft() != NULL && current->getRight() != NULL) {
+        this->nodeSwap(current, this->predecessor(current));
+    }
+
+    Node<Key, Value>* parent = current->getParent();
+    if (current->getLeft() != NULL) {
+        this->promoteNode(current, parent, current->getLeft());
+    } else if (current->getRight() != NULL) {
+        this->promoteNode(current, parent, current->getRight());
+    } else {
+        this->removeNode(current);
+    }
+
+    if (parent != NULL) splay(parent);
+}
+
+template<class Key, class Value, class Compare>
+typename SplayTree<Key, Value, Compare>::iterator
+SplayTree<Key, Value, Compare>::find(const Key& key)
+{
+    return this->makeIterator(splayFind(key));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+typename SplayTree<Key, Value, Compare>::iterator
+SplayTree<Key, Value, Compare>::find(const K& key)
+{
+    return this->makeIterator(splayFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& SplayTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Node<Key, Value>* curr = splayFind(key);
+    if (curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value, class Compare>
+template<typename K>
+Node<Key, Value>* SplayTree<Key, Value, Compare>::splayFind(const K& key)
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* last = NULL;
+    while (current != NULL) {
+        last = current;
+        int c = this->compareKeys(key, current->getKey());
+        if (c < 0) {
+            current = current->getLeft();
+        } else if (c > 0) {
+            current = current->getRight();
+        } else {
+            splay(current);
+            return current;
+        }
+    }
+    if (last != NULL) splay(last);
+    return NULL;
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::splay(Node<Key, Value>* n)
+{
+    while (n->getParent() != NULL) {
+        Node<Key, Value>* parent = n->getParent();
+        Node<Key, Value>* grandparent = parent->getParent();
+        bool nIsLeft = (parent->getLeft() == n);
+
+        // Zig: parent is the root
+        if (grandparent == NULL) {
+            if (nIsLeft) this->rightRotate(parent, n);
+            else this->leftRotate(parent, n);
+        }
+        // Zig-zig: n and parent are both left or both right children
+        else if (nIsLeft == (grandparent->getLeft() == parent)) {
+            if (nIsLeft) {
+                this->rightRotate(grandparent, parent);
+                this->rightRotate(parent, n);
+            } else {
+                this->leftRotate(grandparent, parent);
+                this->leftRotate(parent, n);
+            }
+        }
+        // Zig-zag: rotate n up twice
+        else {
+            if (nIsLeft) {
+                this->rightRotate(parent, n);
+                this->leftRotate(grandparent, n);
+            } else {
+                this->leftRotate(parent, n);
+                this->rightRotate(grandparent, n);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef STATS_BST_H
+#define STATS_BST_H
+
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "bst.h"
+
+/**
+ * Shape of a tree as measured by ShapeAnalyzer. Depths count edges from
+ * the root, as in equalPaths: the root has depth 0.
+ */
+struct ShapeStats
+{
+    size_t nodes;           // linked nodes, tombstones included
+    size_t leaves;
+    size_t deadNodes;       // tombstones (see AVLTree::setTombstones)
+    int minLeafDepth;       // -1 for an empty tree
+    int maxLeafDepth;       // also the height in edges; -1 for an empty tree
+    // Mean number of nodes a successful search visits (mean depth + 1);
+    // 0 for an empty tree
+    double averageSearchDepth;
+    // True if every leaf has the same depth (and for an empty tree)
+    bool equalLeafPaths;
+    // leafDepthHistogram[d] is the number of leaves at depth d
+    std::vector<size_t> leafDepthHistogram;
+};
+
+/**
+ * Measures the shape of a BinarySearchTree (or any subtree of Nodes) in
+ * one O(n) pass with an explicit stack, so degenerate trees of any depth
+ * are fine. Meant for deciding when a tree has drifted far enough from
+ * balanced to be worth rebuilding, e.g. by comparing
+ * averageSearchDepth with log2(nodes).
+ */
+template<typename Key, typename Value, typename Compare = std::less<Key> >
+class ShapeAnalyzer
+{
+public:
+    static ShapeStats analyze(const BinarySearchTree<Key, Value, Compare>& tree);
+    static ShapeStats analyze(const Node<Key, Value>* root);
+};
+
+template<typename Key, typename Value, typename Compare>
+ShapeStats ShapeAnalyzer<Key, Value, Compare>::analyze(const BinarySearchTree<Key, Value, Compare>& tree)
+{
+    return analyze(tree.root_);
+}
+
+template<typename Key, typename Value, typename Compare>
+ShapeStats ShapeAnalyzer<Key, Value, Compare>::analyze(const Node<Key, Value>* root)
+{
+    ShapeStats stats;
+    stats.nodes = 0;
+    stats.leaves = 0;
+    stats.deadNodes = 0;
+    stats.minLeafDepth = -1;
+    stats.maxLeafDepth = -1;
+    stats.averageSearchDepth = 0;
+    stats.equalLeafPaths = true;
+    if (root == NULL) return stats;
+
+    // Pre-order walk; the sum of depths gives the average search depth
+    double depthSum = 0;
+    std::vector<std::pair<const Node<Key, Value>*, int> > pending;
+    pending.push_back(std::make_pair(root, 0));
+    while (!pending.empty()) {
+        const Node<Key, Value>* current = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+
+        ++stats.nodes;
+        depthSum += depth;
+        if (current->isDead()) ++stats.deadNodes;
+
+        const Node<Key, Value>* left = current->getLeft();
+        const Node<Key, Value>* right = current->getRight();
+        if (left == NULL && right == NULL) {
+            ++stats.leaves;
+            if (stats.minLeafDepth < 0 || depth < stats.minLeafDepth) stats.minLeafDepth = depth;
+            if (depth > stats.maxLeafDepth) {
+                stats.maxLeafDepth = depth;
+                stats.leafDepthHistogram.resize(depth + 1, 0);
+            }
+            ++stats.leafDepthHistogram[depth];
+            continue;
+        }
+        if (right != NULL) pending.push_back(std::make_pair(right, depth + 1));
+        if (left != NULL) pending.push_back(std::make_pair(left, depth + 1));
+    }
+
+    stats.averageSearchDepth = depthSum / stats.nodes + 1;
+    stats.equalLeafPaths = (stats.minLeafDepth == stats.maxLeafDepth);
+    return stats;
+}
+
+#endif
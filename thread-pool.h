@@ -0,0 +1,102 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed-size pool of worker threads running tasks from one FIFO queue.
+ *
+ * submit() queues a task; wait() blocks until every task submitted so far
+ * has finished. Tasks must not throw. The destructor finishes the queued
+ * tasks and joins the workers.
+ */
+class ThreadPool
+{
+public:
+    // threads == 0 uses one thread per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    void submit(const std::function<void()>& task);
+    void wait();
+    unsigned size() const;
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()> > tasks_;
+    std::mutex mutex_;
+    std::condition_variable taskReady_;
+    std::condition_variable allDone_;
+    size_t running_;    // queued plus executing tasks
+    bool stopping_;
+};
+
+inline ThreadPool::ThreadPool(unsigned threads) :
+    running_(0), stopping_(false)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    taskReady_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) workers_[i].join();
+}
+
+inline void ThreadPool::submit(const std::function<void()>& task)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        tasks_.push_back(task);
+        ++running_;
+    }
+    taskReady_.notify_one();
+}
+
+inline void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_ != 0) allDone_.wait(lock);
+}
+
+inline unsigned ThreadPool::size() const
+{
+    return (unsigned)workers_.size();
+}
+
+inline void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        while (tasks_.empty() && !stopping_) taskReady_.wait(lock);
+        if (tasks_.empty()) return;
+
+        std::function<void()> task = tasks_.front();
+        tasks_.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+        if (--running_ == 0) allDone_.notify_all();
+    }
+}
+
+#endif
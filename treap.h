@@ -0,0 +1,503 @@
+#ifndef TREAP_H
+#define TREAP_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include "bst.h"
+
+/**
+* A node for a treap, which adds a random heap priority. Priorities are
+* 32 bits, which fits in the padding of most node layouts and is plenty
+* to make ties negligible.
+*/
+template <typename Key, typename Value>
+class TreapNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    TreapNode(const Key& key, const Value& value, TreapNode<Key, Value>* parent, uint32_t priority);
+    virtual ~TreapNode();
+
+    // Getter for the node's priority. Priorities never change.
+    uint32_t getPriority() const;
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to TreapNodes - not plain Nodes.
+    virtual TreapNode<Key, Value>* getParent() const override;
+    virtual TreapNode<Key, Value>* getLeft() const override;
+    virtual TreapNode<Key, Value>* getRight() const override;
+
+protected:
+    uint32_t priority_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the TreapNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor
+*/
+template<class Key, class Value>
+TreapNode<Key, Value>::TreapNode(const Key& key, const Value& value, TreapNode<Key, Value> *parent, uint32_t priority) :
+    Node<Key, Value>(key, value, parent), priority_(priority)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value>::~TreapNode()
+{
+
+}
+
+/**
+* A getter for the priority of a TreapNode.
+*/
+template<class Key, class Value>
+uint32_t TreapNode<Key, Value>::getPriority() const
+{
+    return priority_;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a TreapNode.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value> *TreapNode<Key, Value>::getParent() const
+{
+    return static_cast<TreapNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value> *TreapNode<Key, Value>::getLeft() const
+{
+    return static_cast<TreapNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+TreapNode<Key, Value> *TreapNode<Key, Value>::getRight() const
+{
+    return static_cast<TreapNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the TreapNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A randomized binary search tree: ordered by key, and a max-heap by a
+* random priority, so its shape is that of a BST built from a random
+* insertion order and every operation is O(log n) expected.
+*
+* Besides insert/remove it supports cutting a tree in two by key (split)
+* and concatenating two key-disjoint trees (merge) in O(log n) expected,
+* plus bulk operations built from them:
+*  - insertRange appends keys greater than the current maximum in O(1)
+*    amortized each (O(n) total for sorted input) and inserts the rest.
+*  - unionWith absorbs another treap in O(m log(n/m + 1)) expected. Its two
+*    recursive halves touch disjoint nodes, so they can run in parallel.
+*
+* Priorities come from a per-tree xorshift generator, so a given seed and
+* operation sequence always produce the same shape.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class Treap : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    explicit Treap(uint32_t seed = 0x9E3779B9u, const Compare& comp = Compare());
+    virtual void insert(const std::pair<const Key, Value> &new_item);
+
+    // Moves every item with key >= key into right, replacing its contents
+    void split(const Key& key, Treap<Key, Value, Compare>& right);
+
+    // Moves every item of right into this tree and leaves right empty.
+    // @precondition every key in right is greater than every key in this tree
+    void merge(Treap<Key, Value, Compare>& right);
+
+    // Moves every item of other into this tree and leaves other empty.
+    // Where both trees hold a key, other's value wins (as with insert).
+    void unionWith(Treap<Key, Value, Compare>& other);
+
+    // Inserts [first, last). Runs of increasing keys beyond the current
+    // maximum are appended along the right spine without searching.
+    template<class InputIt>
+    void insertRange(InputIt first, InputIt last);
+
+    // Splits [lo, hi) out, frees it and merges the rest back: expected
+    // O(log n + k)
+    virtual size_t eraseRange(const Key& lo, const Key& hi);
+
+    // Copies shape and priorities node by node in O(n). The copy continues
+    // from the same generator state, so it makes the same future shapes.
+    Treap clone() const;
+
+protected:
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual Node<Key, Value>* copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const;
+    uint32_t nextPriority();
+
+    // Links child below parent on the given side (or as the root)
+    void attach(TreapNode<Key, Value>* parent, bool asRight, TreapNode<Key, Value>* child);
+
+    // Cuts the subtree t into keys < key (left) and keys >= key (right)
+    void splitNodes(TreapNode<Key, Value>* t, const Key& key,
+                    TreapNode<Key, Value>*& left, TreapNode<Key, Value>*& right) const;
+
+    // Joins subtrees l and r, all of whose keys are ordered l < r
+    static TreapNode<Key, Value>* mergeNodes(TreapNode<Key, Value>* l, TreapNode<Key, Value>* r);
+
+    // Union of subtrees a and b; on duplicate keys b's value is kept if bWins
+    TreapNode<Key, Value>* unite(TreapNode<Key, Value>* a, TreapNode<Key, Value>* b, bool bWins) const;
+
+    // Appends a node with a key greater than every key in the tree; last
+    // is the current maximum (NULL if empty). Returns the new node.
+    TreapNode<Key, Value>* append(TreapNode<Key, Value>* last, const std::pair<const Key, Value>& item);
+
+    uint32_t seed_;
+};
+
+template<class Key, class Value, class Compare>
+Treap<Key, Value, Compare>::Treap(uint32_t seed, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp), seed_(seed == 0 ? 1 : seed)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+Treap<Key, Value, Compare> Treap<Key, Value, Compare>::clone() const
+{
+    Treap<Key, Value, Compare> copy(seed_, this->comp_);
+    this->copyInto(copy);
+    return copy;
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* Treap<Key, Value, Compare>::copyNode(const Node<Key, Value>* n, Node<Key, Value>* parent) const
+{
+    const TreapNode<Key, Value>* from = static_cast<const TreapNode<Key, Value>*>(n);
+    return new TreapNode<Key, Value>(from->getKey(), from->getValue(),
+                                     static_cast<TreapNode<Key, Value>*>(parent), from->getPriority());
+}
+
+/**
+* xorshift32: cheap, and good enough to keep the expected depth logarithmic
+*/
+template<class Key, class Value, class Compare>
+uint32_t Treap<Key, Value, Compare>::nextPriority()
+{
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::insert(const std::pair<const Key, Value> &new_item)
+{
+    if (this->root_ == NULL) {
+        this->root_ = new TreapNode<Key, Value>(new_item.first, new_item.second, NULL, nextPriority());
+        this->noteInserted(this->root_);
+        return;
+    }
+
+    TreapNode<Key, Value>* current = static_cast<TreapNode<Key, Value>*>(this->root_);
+    int c;
+    while (true) {
+        c = this->compareKeys(new_item.first, current->getKey());
+        if (c == 0) {
+            current->setValue(new_item.second);
+            return;
+        }
+
+        TreapNode<Key, Value>* next = (c < 0) ? current->getLeft() : current->getRight();
+        if (next == NULL) break;
+        current = next;
+    }
+
+    TreapNode<Key, Value>* newNode = new TreapNode<Key, Value>(new_item.first, new_item.second, current, nextPriority());
+    this->noteInserted(newNode);
+    if (c < 0) {
+        current->setLeft(newNode);
+    } else {
+        current->setRight(newNode);
+    }
+
+    // Rotate the new leaf up until the heap order holds again
+    while (newNode->getParent() != NULL && newNode->getParent()->getPriority() < newNode->getPriority()) {
+        TreapNode<Key, Value>* parent = newNode->getParent();
+        if (parent->getLeft() == newNode) {
+            this->rightRotate(parent, newNode);
+        } else {
+            this->leftRotate(parent, newNode);
+        }
+    }
+}
+
+/*
+ * Replaces the node by the merge of its two subtrees, which needs no
+ * predecessor swap and no rotations.
+ */
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::eraseNode(Node<Key, Value>* node)
+{
+    TreapNode<Key, Value>* current = static_cast<TreapNode<Key, Value>*>(node);
+    this->noteErasing(current);
+
+    TreapNode<Key, Value>* parent = current->getParent();
+    bool asRight = (parent != NULL && parent->getRight() == current);
+    attach(parent, asRight, mergeNodes(current->getLeft(), current->getRight()));
+    this->destroyNode(current);
+}
+
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::split(const Key& key, Treap<Key, Value, Compare>& right)
+{
+    if (&right == this) return;
+    right.clear();
+
+    TreapNode<Key, Value>* l;
+    TreapNode<Key, Value>* r;
+    splitNodes(static_cast<TreapNode<Key, Value>*>(this->root_), key, l, r);
+    this->root_ = l;
+    right.root_ = r;
+    // right was cleared above; this tree's cache may hold nodes now in right
+    this->flushCache();
+    this->resetEnds();
+    right.resetEnds();
+}
+
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::merge(Treap<Key, Value, Compare>& right)
+{
+    if (&right == this) return;
+    this->root_ = mergeNodes(static_cast<TreapNode<Key, Value>*>(this->root_),
+                             static_cast<TreapNode<Key, Value>*>(right.root_));
+    right.root_ = NULL;
+    right.flushCache();
+    this->resetEnds();
+    right.resetEnds();
+}
+
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::unionWith(Treap<Key, Value, Compare>& other)
+{
+    if (&other == this) return;
+    this->root_ = unite(static_cast<TreapNode<Key, Value>*>(this->root_),
+                        static_cast<TreapNode<Key, Value>*>(other.root_), true);
+    if (this->root_ != NULL) this->root_->setParent(NULL);
+    other.root_ = NULL;
+    // unite frees duplicates from either side
+    this->flushCache();
+    other.flushCache();
+    this->resetEnds();
+    other.resetEnds();
+}
+
+template<class Key, class Value, class Compare>
+size_t Treap<Key, Value, Compare>::eraseRange(const Key& lo, const Key& hi)
+{
+    if (this->root_ == NULL || this->compareKeys(lo, hi) >= 0) return 0;
+
+    TreapNode<Key, Value>* left;
+    TreapNode<Key, Value>* rest;
+    TreapNode<Key, Value>* middle;
+    TreapNode<Key, Value>* right;
+    splitNodes(static_cast<TreapNode<Key, Value>*>(this->root_), lo, left, rest);
+    splitNodes(rest, hi, middle, right);
+
+    size_t count = 0;
+    this->freeSubtree(middle, [this, &count](Node<Key, Value>* n) {
+        this->destroyNode(n);
+        ++count;
+    });
+    this->root_ = mergeNodes(left, right);
+    if (this->root_ != NULL) this->root_->setParent(NULL);
+    this->resetEnds();
+    return count;
+}
+
+template<class Key, class Value, class Compare>
+template<class InputIt>
+void Treap<Key, Value, Compare>::insertRange(InputIt first, InputIt last)
+{
+    TreapNode<Key, Value>* max = static_cast<TreapNode<Key, Value>*>(this->findMax(this->root_));
+    for (; first != last; ++first) {
+        // The maximum node never gains a right child from insert(), so it
+        // stays valid across out-of-order keys
+        if (max == NULL || this->compareKeys(max->getKey(), first->first) < 0) {
+            max = append(max, *first);
+        } else {
+            insert(*first);
+        }
+    }
+}
+
+template<class Key, class Value, class Compare>
+TreapNode<Key, Value>* Treap<Key, Value, Compare>::append(TreapNode<Key, Value>* last, const std::pair<const Key, Value>& item)
+{
+    TreapNode<Key, Value>* newNode = new TreapNode<Key, Value>(item.first, item.second, NULL, nextPriority());
+
+    // Walk up the right spine past every node with a lower priority; that
+    // part of the spine becomes the new node's left subtree
+    TreapNode<Key, Value>* below = NULL;
+    while (last != NULL && last->getPriority() < newNode->getPriority()) {
+        below = last;
+        last = last->getParent();
+    }
+
+    newNode->setLeft(below);
+    if (below != NULL) below->setParent(newNode);
+    attach(last, true, newNode);
+    this->noteInserted(newNode);
+    return newNode;
+}
+
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::attach(TreapNode<Key, Value>* parent, bool asRight, TreapNode<Key, Value>* child)
+{
+    if (parent == NULL) {
+        this->root_ = child;
+    } else if (asRight) {
+        parent->setRight(child);
+    } else {
+        parent->setLeft(child);
+    }
+    if (child != NULL) child->setParent(parent);
+}
+
+/**
+* Walks down one search path. Nodes with smaller keys hang off the left
+* result's right spine and the rest off the right result's left spine, in
+* path order, so the heap order is preserved.
+*/
+template<class Key, class Value, class Compare>
+void Treap<Key, Value, Compare>::splitNodes(TreapNode<Key, Value>* t, const Key& key,
+                                            TreapNode<Key, Value>*& left, TreapNode<Key, Value>*& right) const
+{
+    left = right = NULL;
+    TreapNode<Key, Value>* leftTail = NULL;   // attach point on left's right spine
+    TreapNode<Key, Value>* rightTail = NULL;  // attach point on right's left spine
+
+    while (t != NULL) {
+        TreapNode<Key, Value>* next;
+        if (this->compareKeys(t->getKey(), key) < 0) {
+            if (leftTail == NULL) left = t;
+            else leftTail->setRight(t);
+            t->setParent(leftTail);
+            leftTail = t;
+            next = t->getRight();
+        } else {
+            if (rightTail == NULL) right = t;
+            else rightTail->setLeft(t);
+            t->setParent(rightTail);
+            rightTail = t;
+            next = t->getLeft();
+        }
+        t = next;
+    }
+
+    if (leftTail != NULL) leftTail->setRight(NULL);
+    if (rightTail != NULL) rightTail->setLeft(NULL);
+}
+
+/**
+* Zips the right spine of l with the left spine of r by priority.
+*/
+template<class Key, class Value, class Compare>
+TreapNode<Key, Value>* Treap<Key, Value, Compare>::mergeNodes(TreapNode<Key, Value>* l, TreapNode<Key, Value>* r)
+{
+    TreapNode<Key, Value>* root = NULL;
+    TreapNode<Key, Value>* parent = NULL;
+    bool asRight = false;
+
+    while (l != NULL && r != NULL) {
+        // Nodes taken from l continue down their right side, from r their left
+        TreapNode<Key, Value>* top;
+        bool fromLeft = (l->getPriority() > r->getPriority());
+        if (fromLeft) {
+            top = l;
+            l = l->getRight();
+        } else {
+            top = r;
+            r = r->getLeft();
+        }
+
+        if (parent == NULL) root = top;
+        else if (asRight) parent->setRight(top);
+        else parent->setLeft(top);
+        top->setParent(parent);
+
+        parent = top;
+        asRight = fromLeft;
+    }
+
+    TreapNode<Key, Value>* rest = (l != NULL) ? l : r;
+    if (parent == NULL) root = rest;
+    else if (asRight) parent->setRight(rest);
+    else parent->setLeft(rest);
+    if (rest != NULL) rest->setParent(parent);
+    return root;
+}
+
+template<class Key, class Value, class Compare>
+TreapNode<Key, Value>* Treap<Key, Value, Compare>::unite(TreapNode<Key, Value>* a, TreapNode<Key, Value>* b, bool bWins) const
+{
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+
+    // The higher priority root stays on top
+    if (a->getPriority() < b->getPriority()) {
+        std::swap(a, b);
+        bWins = !bWins;
+    }
+
+    TreapNode<Key, Value>* l;
+    TreapNode<Key, Value>* r;
+    splitNodes(b, a->getKey(), l, r);
+
+    // r's minimum may duplicate a's key; it has no left child
+    TreapNode<Key, Value>* dup = r;
+    while (dup != NULL && dup->getLeft() != NULL) dup = dup->getLeft();
+    if (dup != NULL && this->compareKeys(dup->getKey(), a->getKey()) == 0) {
+        if (bWins) a->setValue(dup->getValue());
+        TreapNode<Key, Value>* dupParent = dup->getParent();
+        TreapNode<Key, Value>* dupRight = dup->getRight();
+        if (dupParent == NULL) r = dupRight;
+        else dupParent->setLeft(dupRight);
+        if (dupRight != NULL) dupRight->setParent(dupParent);
+        delete dup;
+    }
+
+    // Independent halves: nothing below is shared between the two calls
+    TreapNode<Key, Value>* left = unite(a->getLeft(), l, bWins);
+    TreapNode<Key, Value>* right = unite(a->getRight(), r, bWins);
+    a->setLeft(left);
+    a->setRight(right);
+    if (left != NULL) left->setParent(a);
+    if (right != NULL) right->setParent(a);
+    return a;
+}
+
+#endif
@@ -0,0 +1,430 @@
+#ifndef VALIDATE_BST_H
+#define VALIDATE_BST_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+#include "avlmultimap.h"
+#include "rbbst.h"
+#include "treap.h"
+
+/**
+ * Incremental invariant checker for BinarySearchTree and its subclasses.
+ *
+ * Verifies BST ordering (by the tree's Compare), parent-pointer
+ * consistency and, for AVL nodes, balance_ correctness (in rank-balanced
+ * mode: rank differences of 1 or 2 and rank-0 leaves; for red-black nodes:
+ * no red node with a red child or at the root, and equal black heights
+ * on both sides; for treap nodes:
+ * heap-ordered priorities; for AVLMultiMap: subtree sizes, with equal
+ * keys allowed) and the cached smallest and largest items, without
+ * paying for a full scan at once:
+ *
+ *  - step(budget) checks at most budget nodes in key order, then
+ *    remembers the last key it checked. The next call resumes just after
+ *    that key, so the tree may be modified between calls (in a multimap,
+ *    the remaining copies of that key are skipped on resume).
+ *  - samplePath() checks one random root-to-leaf path in O(height).
+ *
+ * The first violation found is kept (with its key) until reset().
+ * Keys must be printable with operator<<, as for print().
+ */
+template<typename Key, typename Value, typename Compare = std::less<Key> >
+class TreeValidator
+{
+public:
+    TreeValidator(const BinarySearchTree<Key, Value, Compare>& tree, uint32_t seed = 0);
+
+    // Checks up to budget more nodes. Returns false once a violation is found.
+    bool step(size_t budget);
+
+    // Checks one random root-to-leaf path. Returns false once a violation is found.
+    bool samplePath();
+
+    // Forgets the violation and restarts the sweep from the smallest key.
+    void reset();
+
+    bool ok() const;
+    const std::string& violation() const;
+    const std::string& violationKey() const;
+
+    // Number of complete in-order sweeps finished by step()
+    size_t sweeps() const;
+    // Total number of nodes checked so far
+    size_t nodesChecked() const;
+
+protected:
+    // Checks the invariants that only involve n and its immediate neighbours
+    bool checkNode(Node<Key, Value>* n);
+
+    // The part of checkNode that descents rely on: n's parent and child
+    // pointers agree, and its children's keys are on the right sides
+    bool checkLinks(Node<Key, Value>* n);
+
+    // Checks that an AVL node's balance_ matches its children's heights
+    bool checkBalance(AVLNode<Key, Value>* n);
+
+    // Checks WAVL rank rules: rank differences are 1 or 2, leaves have rank 0
+    bool checkRank(AVLNode<Key, Value>* n);
+
+    // Checks that a red node is not the root and has no red children, and
+    // that both children's subtrees have the same black height
+    bool checkColor(RBNode<Key, Value>* n);
+
+    // Checks that no child has a higher priority than its parent
+    bool checkPriority(TreapNode<Key, Value>* n);
+
+    // Checks that a multimap node's size is one more than its children's
+    bool checkSize(AVLMultiNode<Key, Value>* n);
+
+    // Ordering test between two keys that should be in order: strict,
+    // except in a multimap where equal keys may sit on either side
+    bool outOfOrder(const Key& lo, const Key& hi) const;
+
+    // Height of an AVL subtree following the taller child at each level
+    static int balanceHeight(AVLNode<Key, Value>* n);
+
+    // Black nodes on the leftmost path of a red-black subtree
+    static int blackHeight(RBNode<Key, Value>* n);
+
+    // Sets next to the first node whose key is greater than the last
+    // checked key. The descent checks the links of the nodes it passes,
+    // since a misplaced key could otherwise steer it past its own parent;
+    // returns false if one is broken.
+    bool resumePoint(Node<Key, Value>*& next);
+
+    // Checks the tree's cached smallest and largest live nodes; done at
+    // the start of each sweep, in O(log n) plus any run of tombstones
+    bool checkEnds();
+
+    bool fail(Node<Key, Value>* n, const char* reason);
+
+    const BinarySearchTree<Key, Value, Compare>& tree_;
+    std::vector<Key> lastKey_;  // empty at the start of a sweep
+    std::mt19937 rng_;
+    std::string violation_;
+    std::string violationKey_;
+    size_t sweeps_;
+    size_t checked_;
+    bool rankBalanced_;  // tree is an AVLTree in WAVL mode
+    bool multi_;         // tree is an AVLMultiMap
+};
+
+template<typename Key, typename Value, typename Compare>
+TreeValidator<Key, Value, Compare>::TreeValidator(const BinarySearchTree<Key, Value, Compare>& tree, uint32_t seed) :
+    tree_(tree), rng_(seed), sweeps_(0), checked_(0), rankBalanced_(false), multi_(false)
+{
+    const AVLTree<Key, Value, Compare>* avl = dynamic_cast<const AVLTree<Key, Value, Compare>*>(&tree);
+    if (avl != NULL) rankBalanced_ = avl->isRankBalanced();
+    multi_ = dynamic_cast<const AVLMultiMap<Key, Value, Compare>*>(&tree) != NULL;
+
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::ok() const
+{
+    return violation_.empty();
+}
+
+template<typename Key, typename Value, typename Compare>
+const std::string& TreeValidator<Key, Value, Compare>::violation() const
+{
+    return violation_;
+}
+
+template<typename Key, typename Value, typename Compare>
+const std::string& TreeValidator<Key, Value, Compare>::violationKey() const
+{
+    return violationKey_;
+}
+
+template<typename Key, typename Value, typename Compare>
+size_t TreeValidator<Key, Value, Compare>::sweeps() const
+{
+    return sweeps_;
+}
+
+template<typename Key, typename Value, typename Compare>
+size_t TreeValidator<Key, Value, Compare>::nodesChecked() const
+{
+    return checked_;
+}
+
+template<typename Key, typename Value, typename Compare>
+void TreeValidator<Key, Value, Compare>::reset()
+{
+    lastKey_.clear();
+    violation_.clear();
+    violationKey_.clear();
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::fail(Node<Key, Value>* n, const char* reason)
+{
+    std::ostringstream key;
+    key << n->getKey();
+    violation_ = reason;
+    violationKey_ = key.str();
+    return false;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::resumePoint(Node<Key, Value>*& next)
+{
+    if (lastKey_.empty()) {
+        next = BinarySearchTree<Key, Value, Compare>::findMin(tree_.root_);
+        return true;
+    }
+
+    // Descend once from the root instead of keeping a node pointer, so
+    // inserts and removes between calls cannot leave us with a stale cursor
+    Node<Key, Value>* candidate = NULL;
+    Node<Key, Value>* current = tree_.root_;
+    while (current != NULL) {
+        if (!checkLinks(current)) return false;
+        if (tree_.compareKeys(lastKey_[0], current->getKey()) < 0) {
+            candidate = current;
+            current = current->getLeft();
+        } else {
+            current = current->getRight();
+        }
+    }
+    next = candidate;
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::step(size_t budget)
+{
+    if (!ok()) return false;
+    if (lastKey_.empty() && budget > 0 && !checkEnds()) return false;
+
+    Node<Key, Value>* current = NULL;
+    if (!resumePoint(current)) return false;
+    for (size_t i = 0; i < budget; ++i) {
+        // Reached the end of the tree: start a new sweep next time
+        if (current == NULL) {
+            lastKey_.clear();
+            ++sweeps_;
+            return true;
+        }
+
+        if (!checkNode(current)) return false;
+
+        // In-order keys must be strictly increasing (non-decreasing in a
+        // multimap), which together with the local checks implies global
+        // BST ordering
+        if (!lastKey_.empty() && outOfOrder(lastKey_[0], current->getKey())) {
+            return fail(current, "key is not greater than its in-order predecessor");
+        }
+        lastKey_.assign(1, current->getKey());
+        current = BinarySearchTree<Key, Value, Compare>::successor(current);
+    }
+
+    if (current == NULL) {
+        lastKey_.clear();
+        ++sweeps_;
+    }
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkEnds()
+{
+    typedef BinarySearchTree<Key, Value, Compare> Tree;
+    Node<Key, Value>* first = Tree::findMin(tree_.root_);
+    while (first != NULL && first->isDead()) first = Tree::successor(first);
+    Node<Key, Value>* last = Tree::findMax(tree_.root_);
+    while (last != NULL && last->isDead()) last = Tree::predecessor(last);
+
+    // A stale cached pointer may be dangling, so only the real ends are
+    // ever dereferenced here
+    const char* reason = NULL;
+    Node<Key, Value>* where = NULL;
+    if (tree_.minNode_ != first) {
+        reason = "cached minimum is not the smallest live node";
+        where = first;
+    } else if (tree_.maxNode_ != last) {
+        reason = "cached maximum is not the largest live node";
+        where = last;
+    }
+    if (reason == NULL) return true;
+    if (where != NULL) return fail(where, reason);
+    violation_ = reason;
+    violationKey_.clear();
+    return false;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::samplePath()
+{
+    if (!ok()) return false;
+
+    // Keys on the path bound every key below them from one side
+    Node<Key, Value>* lower = NULL;
+    Node<Key, Value>* upper = NULL;
+    Node<Key, Value>* current = tree_.root_;
+    while (current != NULL) {
+        if (!checkNode(current)) return false;
+        if (lower != NULL && outOfOrder(lower->getKey(), current->getKey())) {
+            return fail(current, "key is not greater than an ancestor it descends right from");
+        }
+        if (upper != NULL && outOfOrder(current->getKey(), upper->getKey())) {
+            return fail(current, "key is not less than an ancestor it descends left from");
+        }
+
+        Node<Key, Value>* left = current->getLeft();
+        Node<Key, Value>* right = current->getRight();
+        bool goLeft = (right == NULL) || (left != NULL && (rng_() & 1));
+        if (goLeft) {
+            upper = current;
+            current = left;
+        } else {
+            lower = current;
+            current = right;
+        }
+    }
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkNode(Node<Key, Value>* n)
+{
+    ++checked_;
+    if (!checkLinks(n)) return false;
+
+    if (multi_ && !checkSize(static_cast<AVLMultiNode<Key, Value>*>(n))) return false;
+    AVLNode<Key, Value>* avl = dynamic_cast<AVLNode<Key, Value>*>(n);
+    if (avl != NULL) return rankBalanced_ ? checkRank(avl) : checkBalance(avl);
+    RBNode<Key, Value>* rb = dynamic_cast<RBNode<Key, Value>*>(n);
+    if (rb != NULL) return checkColor(rb);
+    TreapNode<Key, Value>* treap = dynamic_cast<TreapNode<Key, Value>*>(n);
+    if (treap != NULL) return checkPriority(treap);
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkLinks(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent = n->getParent();
+    Node<Key, Value>* left = n->getLeft();
+    Node<Key, Value>* right = n->getRight();
+
+    if (parent == NULL) {
+        if (n != tree_.root_) return fail(n, "node has no parent but is not the root");
+    } else if (parent->getLeft() != n && parent->getRight() != n) {
+        return fail(n, "parent does not point back to node");
+    }
+
+    if (left != NULL) {
+        if (left->getParent() != n) return fail(left, "left child's parent pointer is wrong");
+        if (outOfOrder(left->getKey(), n->getKey())) return fail(left, "left child's key is not less than its parent's");
+    }
+    if (right != NULL) {
+        if (right->getParent() != n) return fail(right, "right child's parent pointer is wrong");
+        if (outOfOrder(n->getKey(), right->getKey())) return fail(right, "right child's key is not greater than its parent's");
+    }
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkColor(RBNode<Key, Value>* n)
+{
+    if (n->isRed()) {
+        if (n == tree_.root_) return fail(n, "root is red");
+        if ((n->getLeft() != NULL && n->getLeft()->isRed()) || (n->getRight() != NULL && n->getRight()->isRed())) {
+            return fail(n, "red node has a red child");
+        }
+    }
+
+    // As with AVL heights, one path per child keeps this O(log n): each
+    // child's own paths are compared when the child is checked
+    if (blackHeight(n->getLeft()) != blackHeight(n->getRight())) {
+        return fail(n, "children's subtrees have different black heights");
+    }
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkPriority(TreapNode<Key, Value>* n)
+{
+    if ((n->getLeft() != NULL && n->getLeft()->getPriority() > n->getPriority()) ||
+        (n->getRight() != NULL && n->getRight()->getPriority() > n->getPriority())) {
+        return fail(n, "treap child has a higher priority than its parent");
+    }
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkSize(AVLMultiNode<Key, Value>* n)
+{
+    size_t expected = 1 + AVLMultiNode<Key, Value>::sizeOf(n->getLeft()) + AVLMultiNode<Key, Value>::sizeOf(n->getRight());
+    if (n->getSize() != expected) return fail(n, "subtree size does not match its children's");
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::outOfOrder(const Key& lo, const Key& hi) const
+{
+    int c = tree_.compareKeys(lo, hi);
+    return multi_ ? c > 0 : c >= 0;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkBalance(AVLNode<Key, Value>* n)
+{
+    int8_t balance = n->getBalance();
+    if (balance < -1 || balance > 1) return fail(n, "AVL balance is out of range");
+
+    // Child heights are derived from the children's own balance_ fields,
+    // which keeps this O(log n); those fields are verified when the
+    // children themselves are checked
+    int diff = balanceHeight(n->getRight()) - balanceHeight(n->getLeft());
+    if (diff != balance) return fail(n, "AVL balance does not match subtree heights");
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool TreeValidator<Key, Value, Compare>::checkRank(AVLNode<Key, Value>* n)
+{
+    AVLNode<Key, Value>* left = n->getLeft();
+    AVLNode<Key, Value>* right = n->getRight();
+    int leftDiff = n->getRank() - (left == NULL ? -1 : left->getRank());
+    int rightDiff = n->getRank() - (right == NULL ? -1 : right->getRank());
+    if (leftDiff < 1 || leftDiff > 2 || rightDiff < 1 || rightDiff > 2) {
+        return fail(n, "WAVL rank difference is not 1 or 2");
+    }
+    if (left == NULL && right == NULL && n->getRank() != 0) {
+        return fail(n, "WAVL leaf does not have rank 0");
+    }
+    return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+int TreeValidator<Key, Value, Compare>::balanceHeight(AVLNode<Key, Value>* n)
+{
+    int h = 0;
+    while (n != NULL) {
+        ++h;
+        n = (n->getBalance() > 0) ? n->getRight() : n->getLeft();
+    }
+    return h;
+}
+
+template<typename Key, typename Value, typename Compare>
+int TreeValidator<Key, Value, Compare>::blackHeight(RBNode<Key, Value>* n)
+{
+    int h = 0;
+    while (n != NULL) {
+        if (!n->isRed()) ++h;
+        n = n->getLeft();
+    }
+    return h;
+}
+
+#endif